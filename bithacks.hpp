@@ -50,7 +50,7 @@ template <auto N, auto M> static constexpr auto bits() {
     // type deduction.
     auto res{bit<M>()};
     for (auto i = N; i < M; i++) {
-        res |= bit<typeof(res)>(i);
+        res |= bit<decltype(res)>(i);
     }
 
     return res;
@@ -1,9 +1,62 @@
 #include <iostream>
+#include <string>
+#include <vector>
 
-using namespace std;
+#include "presolver/commands.hpp"
 
-int main()
-{
-    cout << "Hello World!" << endl;
-    return 0;
+namespace {
+
+/**
+ * @brief Subcommand of m-queens3, runs one of the programs with some options set.
+ */
+struct command {
+        char const *name;
+        char const *description;
+        int (*run)(std::string const &program, int argc, char *argv[]);
+        char const *option; // Added to the arguments of the program, nullptr if none
+};
+
+constexpr command COMMANDS[]{
+    {"presolve", "Generate work units into a file, needs --output", queens::presolver_main, "--presolve-only"},
+    {"solve", "Generate or load work units and solve them", queens::presolver_main, nullptr},
+    {"verify", "Check an engine against the recursive engine for all N up to the boardsize", queens::presolver_main,
+     "--verify"},
+    {"bench", "Benchmark the preplacement and the solver engines", queens::benchmark_main, nullptr},
+};
+
+void usage(std::ostream &out) {
+    out << "Usage: m-queens3 <command> [OPTION...]" << std::endl << std::endl << "Commands:" << std::endl;
+    for (command const &c : COMMANDS) {
+        out << "  " << c.name << std::string(10 - std::string{c.name}.size(), ' ') << c.description << std::endl;
+    }
+    out << std::endl << "See m-queens3 <command> --help for the options of a command." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || std::string{argv[1]} == "-h" || std::string{argv[1]} == "--help") {
+        usage(std::cout);
+        return argc < 2 ? -1 : 0;
+    }
+
+    for (command const &c : COMMANDS) {
+        if (argv[1] != std::string{c.name}) {
+            continue;
+        }
+        // The program sees "m-queens3 <command>" as its name, followed by the remaining arguments
+        std::string const program{std::string{"m-queens3 "} + c.name};
+        std::vector<char *> args{argv[0]};
+        args.insert(args.end(), argv + 2, argv + argc);
+        std::string option{c.option != nullptr ? c.option : ""};
+        if (!option.empty()) {
+            args.push_back(option.data());
+        }
+        args.push_back(nullptr);
+        return c.run(program, static_cast<int>(args.size() - 1), args.data());
+    }
+
+    std::cout << "Unknown command: " << argv[1] << std::endl;
+    usage(std::cout);
+    return -1;
 }
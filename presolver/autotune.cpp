@@ -0,0 +1,129 @@
+#include "autotune.hpp"
+
+#include "coronal2.hpp"
+#include "mini_board.hpp"
+#include "solver_engine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace queens;
+
+// Number of work units in the sample
+static constexpr size_t SAMPLE_UNITS = 512;
+// Preplacements skipped between two units of the sample, so it is not made of neighbours only
+static constexpr uint64_t SAMPLE_STRIDE = 64;
+// The reference engine solves chunks of the sample until this much time has passed, the others solve as many
+static constexpr std::chrono::milliseconds BUDGET{500};
+// An engine is given up once it takes this many times as long as the fastest one so far
+static constexpr double GIVE_UP = 4;
+
+/**
+ * @brief Time an engine on a number of chunks of SOLVE_CHUNK units, taken round robin from the sample.
+ * @param limit Stop once this many seconds have passed, the result is then incomplete
+ * @param completions Output, sum of the completions of all units solved
+ * @return Seconds taken and true, or the seconds so far and false if the limit was reached
+ */
+static std::pair<double, bool> time_engine(SolverEngine engine, std::vector<mini_board> const &sample, size_t chunks,
+                                           uint8_t n, uint8_t ring_width, double limit, uint64_t &completions) {
+    std::vector<uint64_t> out(SOLVE_CHUNK);
+    completions = 0;
+    auto const start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    size_t first = 0;
+    for (size_t c = 0; c < chunks; c++) {
+        size_t const count = std::min(SOLVE_CHUNK, sample.size() - first);
+        engine(sample.data() + first, count, n, ring_width, out.data());
+        for (size_t i = 0; i < count; i++) {
+            completions += out[i];
+        }
+        first = first + count == sample.size() ? 0 : first + count;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds > limit) {
+            return {seconds, false};
+        }
+    }
+    return {seconds, true};
+}
+
+static std::string tune(isa_variant const &isa, uint8_t n, uint8_t ring_width, std::ostream &log) {
+    std::vector<mini_board> sample;
+    preplacement_generator generator{n, ring_width};
+    std::vector<preplacement_generator::unit> pulled;
+    while (sample.size() < SAMPLE_UNITS && generator.pull(pulled, 1) == 1) {
+        sample.emplace_back(pulled.back().first, ring_width);
+        pulled.clear();
+        generator.skip(SAMPLE_STRIDE - 1);
+    }
+
+    // The reference runs over the sample, as often as needed, until the budget is spent. This sets the number of
+    // chunks and the expected completions for the others.
+    std::string_view const reference{ENGINES.front().name};
+    SolverEngine const reference_engine{isa.select(reference, n)};
+    std::vector<uint64_t> out(SOLVE_CHUNK);
+    size_t chunks = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (size_t first = 0; chunks == 0 || std::chrono::steady_clock::now() - start < BUDGET; chunks++) {
+        size_t const count = std::min(SOLVE_CHUNK, sample.size() - first);
+        reference_engine(sample.data() + first, count, n, ring_width, out.data());
+        first = first + count == sample.size() ? 0 : first + count;
+    }
+    uint64_t expected;
+    time_engine(reference_engine, sample, chunks, n, ring_width, std::numeric_limits<double>::infinity(), expected);
+
+    log << "Autotune for boardsize " << unsigned{n} << " on " << sample.size() << " work units, " << chunks
+        << " chunks, isa: " << isa.name << std::endl;
+    std::string best;
+    double best_seconds = 0;
+    for (engine_info const &info : ENGINES) {
+        SolverEngine const engine{isa.select(info.name, n)};
+        log << "  " << info.name << ": ";
+        if (info.experimental) {
+            log << "experimental, left out" << std::endl;
+            continue;
+        }
+        if (engine == nullptr) {
+            log << "can't solve this boardsize" << std::endl;
+            continue;
+        }
+        double const limit = best.empty() ? std::chrono::duration<double>(BUDGET).count() * GIVE_UP
+                                          : best_seconds * GIVE_UP;
+        uint64_t completions;
+        auto const [seconds, complete] = time_engine(engine, sample, chunks, n, ring_width, limit, completions);
+        if (!complete) {
+            log << "given up after " << seconds << " s" << std::endl;
+        } else if (completions != expected) {
+            log << completions << " completions instead of " << expected << ", left out" << std::endl;
+        } else {
+            log << seconds << " s" << std::endl;
+            if (best.empty() || seconds < best_seconds) {
+                best = info.name;
+                best_seconds = seconds;
+            }
+        }
+    }
+    if (best.empty()) {
+        best = reference;
+    }
+    log << "  picked " << best << std::endl;
+    return best;
+}
+
+std::string queens::autotune_engine(isa_variant const &isa, uint8_t n, uint8_t ring_width, std::ostream &log) {
+    static std::mutex mutex;
+    static std::map<std::tuple<std::string, unsigned, unsigned>, std::string> chosen;
+
+    std::lock_guard const lock{mutex};
+    std::tuple<std::string, unsigned, unsigned> const key{isa.name, n, ring_width};
+    auto const it = chosen.find(key);
+    if (it != chosen.end()) {
+        return it->second;
+    }
+    return chosen[key] = tune(isa, n, ring_width, log);
+}
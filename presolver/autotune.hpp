@@ -0,0 +1,25 @@
+#pragma once
+
+#include "engines.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace queens {
+
+/**
+ * @brief Pick the fastest engine for a board size on this CPU by timing the engines of a feature level.
+ *
+ * The engines solve the same sample of work units, taken spread over the first preplacements of the board size, on
+ * one thread. Experimental engines, engines which can't solve the board size and ones which count other totals
+ * than the recursive engine are left out. The choice is kept per feature level, board size and ring width, later
+ * and concurrent calls wait for and reuse it.
+ * @param isa Feature level variant whose engines are timed
+ * @param n Size of the board
+ * @param ring_width Width of the coronal ring of the work units
+ * @param log Receives the time of each engine and the choice
+ * @return Name of the fastest engine
+ */
+std::string autotune_engine(isa_variant const &isa, uint8_t n, uint8_t ring_width, std::ostream &log);
+
+} // namespace queens
@@ -0,0 +1,389 @@
+#include "cxxopts.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "board.hpp"
+#include "chunk_solver.hpp"
+#include "commands.hpp"
+#include "coronal2.hpp"
+#include "dedup.hpp"
+#include "engines.hpp"
+#include "mini_board.hpp"
+#include "packed_unit.hpp"
+#include "results.hpp"
+#include "solver_engine.hpp"
+#include "subproblem.hpp"
+#include "symmetry.hpp"
+#include "work_order.hpp"
+
+/**
+ * @brief Silence std::cout while alive, preplace() reports its progress there and the results may go to stdout.
+ */
+class mute_cout {
+        std::ostringstream m_sink;
+        std::streambuf *m_saved;
+
+    public:
+        mute_cout() : m_saved{std::cout.rdbuf(m_sink.rdbuf())} {}
+        ~mute_cout() { std::cout.rdbuf(m_saved); }
+};
+
+/**
+ * @brief Run fn repeat times and return the wall clock time of each run in seconds.
+ */
+template <typename Fn> static std::vector<double> time_runs(unsigned repeat, Fn &&fn) {
+    std::vector<double> times;
+    for (unsigned r = 0; r < repeat; r++) {
+        auto const start = std::chrono::steady_clock::now();
+        fn();
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+        times.push_back(elapsed.count());
+    }
+    return times;
+}
+
+/**
+ * @brief Work units of a board size, all symmetry classes in generation order.
+ */
+static std::vector<queens::mini_board> generate(uint8_t n, uint8_t ring_width) {
+    std::vector<queens::mini_board> units;
+    mute_cout mute;
+    preplace(
+        n, [&](queens::Board const &brd, queens::Symmetry::Direction) { units.emplace_back(brd, ring_width); },
+        ring_width);
+    return units;
+}
+
+/**
+ * @brief Collects the measurements of one run as a JSON document.
+ */
+class json_report {
+        std::ostringstream m_out;
+        bool m_first_section{true};
+        bool m_first_entry{true};
+        bool m_first_field{true};
+
+    public:
+        json_report(std::string const &isa, unsigned ring_width, unsigned repeat, unsigned threads) {
+            m_out << "{\n  \"isa\": \"" << isa << "\",\n  \"ring_width\": " << ring_width << ",\n  \"repeat\": " << repeat
+                  << ",\n  \"threads\": " << threads << ",\n  \"timestamp\": " << std::time(nullptr);
+            m_out.precision(6);
+        }
+
+        void section(char const *name) {
+            close_section();
+            m_out << ",\n  \"" << name << "\": [";
+            m_first_section = false;
+            m_first_entry = true;
+        }
+
+        /**
+         * @brief Start an entry of the current section, the fields are written with field().
+         */
+        json_report &entry() {
+            m_out << (m_first_entry ? "\n    {" : "},\n    {");
+            m_first_entry = false;
+            m_first_field = true;
+            return *this;
+        }
+
+        template <typename T> json_report &field(char const *name, T const &value) {
+            m_out << (m_first_field ? "" : ", ") << '"' << name << "\": ";
+            if constexpr (std::is_convertible_v<T, std::string>) {
+                m_out << '"' << value << '"';
+            } else if constexpr (std::is_same_v<T, bool>) {
+                m_out << (value ? "true" : "false");
+            } else {
+                m_out << value;
+            }
+            m_first_field = false;
+            return *this;
+        }
+
+        /**
+         * @brief Best and mean of repeated timings.
+         */
+        json_report &times(std::vector<double> const &times) {
+            double const best = *std::min_element(times.begin(), times.end());
+            double const mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+            return field("best_s", best).field("mean_s", mean);
+        }
+
+        std::string finish() {
+            close_section();
+            m_out << "\n}\n";
+            return m_out.str();
+        }
+
+    private:
+        void close_section() {
+            if (!m_first_section) {
+                m_out << (m_first_entry ? "" : "}") << "\n  ]";
+            }
+        }
+};
+
+int queens::benchmark_main(std::string const &program, int argc, char *argv[]) {
+    cxxopts::Options options(program, "Benchmarks of the preplacement and the solver engines");
+    // clang-format off
+    options.add_options()
+        ("e,engine", "Engines to measure, all if not given", cxxopts::value<std::vector<std::string>>())
+        ("isa", "Use the engines built for this x86-64 feature level instead of the best one the CPU supports", cxxopts::value<std::string>())
+        ("ring-width", "Width of the coronal ring of preplaced queens", cxxopts::value<unsigned>()->default_value("2"))
+        ("preplace", "Board sizes to measure the preplacement for", cxxopts::value<std::vector<unsigned>>()->default_value("10,12,14,16"))
+        ("corpus", "Board sizes of the work unit corpora for the single thread engine measurement", cxxopts::value<std::vector<unsigned>>()->default_value("14,16,18"))
+        ("corpus-units", "Number of work units per corpus, taken evenly spread from all units", cxxopts::value<size_t>()->default_value("4096"))
+        ("dedup", "Board sizes to measure the work unit deduplication for", cxxopts::value<std::vector<unsigned>>()->default_value("14,16"))
+        ("solve", "Largest board size of the end to end solves, they start at 8", cxxopts::value<unsigned>()->default_value("18"))
+        ("t,threads", "Number of solver threads of the end to end solves, all hardware threads if not given", cxxopts::value<unsigned>())
+        ("order", "Order of the work units of the end to end solves [generated, cost], as in the presolver", cxxopts::value<std::string>()->default_value("generated"))
+        ("split", "Split budget of the end to end solves, as in the presolver, 0 disables", cxxopts::value<uint64_t>()->default_value("0"))
+        ("r,repeat", "Number of runs per measurement", cxxopts::value<unsigned>()->default_value("3"))
+        ("o,output", "Write the JSON results to this file instead of stdout", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    // clang-format on
+
+    auto result = options.parse(argc, argv);
+    if (result.count("help")) {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    std::vector<std::string> engines;
+    for (queens::engine_info const &engine : queens::ENGINES) {
+        engines.emplace_back(engine.name);
+    }
+    if (result.count("engine")) {
+        engines = result["engine"].as<std::vector<std::string>>();
+        for (std::string const &engine : engines) {
+            if (!queens::known_engine(engine)) {
+                std::cerr << "Unknown engine: " << engine << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    queens::isa_variant const *isa{&queens::best_isa_variant()};
+    if (result.count("isa")) {
+        auto const variants{queens::isa_variants()};
+        auto const it{std::find_if(variants.begin(), variants.end(), [&](queens::isa_variant const &v) {
+            return v.name == result["isa"].as<std::string>();
+        })};
+        if (it == variants.end() || !it->supported()) {
+            std::cerr << "Feature level " << result["isa"].as<std::string>() << " is not built or not supported"
+                      << std::endl;
+            return -1;
+        }
+        isa = &*it;
+    }
+
+    uint8_t const ring_width = std::min(result["ring-width"].as<unsigned>(), 255u);
+    unsigned const repeat = std::max(1u, result["repeat"].as<unsigned>());
+    unsigned const threads{result.count("threads") ? std::max(1u, result["threads"].as<unsigned>())
+                                                   : std::max(1u, std::thread::hardware_concurrency())};
+    auto const order{result["order"].as<std::string>()};
+    if (order != "generated" && order != "cost") {
+        std::cerr << "Unknown order: " << order << std::endl;
+        return -1;
+    }
+    bool const by_cost = order == "cost";
+    auto const split_budget{result["split"].as<uint64_t>()};
+    auto const valid_n = [&](unsigned n) {
+        return n <= std::size(results) && 2 * ring_width < n && n <= queens::subproblem::max_boardsize(ring_width);
+    };
+
+    json_report report{isa->name, ring_width, repeat, threads};
+    bool ok = true;
+
+    report.section("preplace");
+    for (unsigned n : result["preplace"].as<std::vector<unsigned>>()) {
+        if (!valid_n(n)) {
+            continue;
+        }
+        std::cerr << "preplace N=" << n << std::endl;
+        size_t units = 0;
+        auto const times = time_runs(repeat, [&]() { units = generate(n, ring_width).size(); });
+        report.entry().field("n", n).field("units", units).times(times).field(
+            "units_per_s", units / *std::min_element(times.begin(), times.end()));
+    }
+
+    report.section("corpus");
+    size_t const corpus_units = std::max<size_t>(1, result["corpus-units"].as<size_t>());
+    for (unsigned n : result["corpus"].as<std::vector<unsigned>>()) {
+        if (!valid_n(n)) {
+            continue;
+        }
+        std::vector<queens::mini_board> const all{generate(n, ring_width)};
+        // Same stride for every run and commit, so the corpus of an N never changes
+        size_t const stride = std::max<size_t>(1, all.size() / corpus_units);
+        std::vector<queens::mini_board> corpus;
+        for (size_t i = 0; i < all.size() && corpus.size() < corpus_units; i += stride) {
+            corpus.push_back(all[i]);
+        }
+        // Search states of the recursive engine, the work every engine does in its own way
+        std::vector<uint64_t> out(corpus.size());
+        uint64_t const nodes{isa->select("recursive", n)(corpus.data(), corpus.size(), n, ring_width, out.data())};
+
+        for (std::string const &engine_name : engines) {
+            std::cerr << "corpus N=" << n << " engine " << engine_name << std::endl;
+            queens::SolverEngine const engine{isa->select(engine_name, n)};
+            uint64_t visited = 0;
+            auto const times = time_runs(repeat, [&]() {
+                visited = 0;
+                for (size_t first = 0; first < corpus.size(); first += queens::SOLVE_CHUNK) {
+                    size_t const count = std::min(queens::SOLVE_CHUNK, corpus.size() - first);
+                    visited += engine(corpus.data() + first, count, n, ring_width, out.data() + first);
+                }
+            });
+            uint64_t const completions = std::accumulate(out.begin(), out.end(), uint64_t{0});
+            report.entry()
+                .field("n", n)
+                .field("engine", engine_name)
+                .field("units", corpus.size())
+                .field("nodes", nodes)
+                .field("visited", visited)
+                .field("completions", completions)
+                .times(times)
+                .field("nodes_per_s", nodes / *std::min_element(times.begin(), times.end()));
+        }
+    }
+
+    // Time of the dedup pass against the solve time it saves, the solve is timed on one thread with the first engine
+    report.section("dedup");
+    for (unsigned n : result["dedup"].as<std::vector<unsigned>>()) {
+        if (!valid_n(n)) {
+            continue;
+        }
+        std::cerr << "dedup N=" << n << std::endl;
+        std::array<std::vector<queens::mini_board>, queens::ALL_SYMMETRIES.size()> units;
+        {
+            mute_cout mute;
+            preplace(
+                n,
+                [&](queens::Board const &brd, queens::Symmetry::Direction sym) {
+                    units[queens::Symmetry{sym}].emplace_back(brd, ring_width);
+                },
+                ring_width);
+        }
+        size_t total = 0;
+        size_t unique = 0;
+        auto const times = time_runs(repeat, [&]() {
+            total = 0;
+            unique = 0;
+            for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                total += units[sym].size();
+                unique += queens::deduplicate(units[sym], n, ring_width).units.size();
+            }
+        });
+        queens::SolverEngine const engine{isa->select(engines.front(), n)};
+        auto const solve_times = time_runs(1, [&]() {
+            std::array<uint64_t, queens::SOLVE_CHUNK> out;
+            for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                for (size_t first = 0; first < units[sym].size(); first += queens::SOLVE_CHUNK) {
+                    size_t const count = std::min(queens::SOLVE_CHUNK, units[sym].size() - first);
+                    engine(units[sym].data() + first, count, n, ring_width, out.data());
+                }
+            }
+        });
+        double const ratio = total ? static_cast<double>(unique) / total : 1.0;
+        report.entry()
+            .field("n", n)
+            .field("units", total)
+            .field("unique", unique)
+            .field("ratio", ratio)
+            .times(times)
+            .field("engine", engines.front())
+            .field("solve_s", solve_times.front())
+            .field("saved_s", solve_times.front() * (1 - ratio));
+    }
+
+    // End to end solves through the driver of the presolver, so the work pool, the order and the split are measured
+    report.section("solve");
+    for (unsigned n = 8; n <= result["solve"].as<unsigned>(); n++) {
+        if (!valid_n(n)) {
+            continue;
+        }
+        for (std::string const &engine_name : engines) {
+            std::cerr << "solve N=" << n << " engine " << engine_name << std::endl;
+            queens::SolverEngine const engine{isa->select(engine_name, n)};
+            uint64_t total = 0;
+            auto const times = time_runs(repeat, [&]() {
+                // Packed where they fit, like the presolver stores them
+                bool const pack = queens::packed_unit::fits(n, ring_width);
+                std::array<std::vector<queens::mini_board>, queens::ALL_SYMMETRIES.size()> units;
+                std::array<std::vector<queens::packed_unit>, queens::ALL_SYMMETRIES.size()> packed;
+                {
+                    mute_cout mute;
+                    preplace(
+                        n,
+                        [&](queens::Board const &brd, queens::Symmetry::Direction sym) {
+                            if (pack) {
+                                packed[queens::Symmetry{sym}].push_back(queens::packed_unit::pack(brd, ring_width));
+                            } else {
+                                units[queens::Symmetry{sym}].emplace_back(brd, ring_width);
+                            }
+                        },
+                        ring_width);
+                }
+
+                std::array<size_t, queens::ALL_SYMMETRIES.size()> unit_counts;
+                std::array<std::vector<double>, queens::ALL_SYMMETRIES.size()> costs;
+                queens::solve_plan plan{isa, engine, static_cast<uint8_t>(n), ring_width, {}, {}, {}, threads,
+                                        split_budget, {}, {}, false};
+                for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                    if (by_cost) {
+                        std::vector<uint32_t> occurrences;
+                        costs[sym] = pack ? queens::sort_by_cost(packed[sym], occurrences, n, ring_width)
+                                          : queens::sort_by_cost(units[sym], occurrences, n, ring_width);
+                    }
+                    plan.work[sym] = pack ? queens::unit_span{packed[sym], static_cast<uint8_t>(n), ring_width}
+                                          : queens::unit_span{units[sym]};
+                    unit_counts[sym] = plan.work[sym].size();
+                }
+                plan.chunks = queens::list_chunks(unit_counts, costs);
+
+                queens::solve_outcome const outcome{queens::solve_chunks(plan)};
+                total = 0;
+                for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                    total += outcome.counts[sym] * sym.weight();
+                }
+            });
+            bool const pass = total == results[n - 1];
+            ok &= pass;
+            report.entry()
+                .field("n", n)
+                .field("engine", engine_name)
+                .field("order", order)
+                .field("split", split_budget)
+                .field("pass", pass)
+                .times(times);
+        }
+    }
+
+    std::string const json{report.finish()};
+    if (result.count("output")) {
+        std::ofstream file{result["output"].as<std::string>()};
+        file << json;
+        if (!file) {
+            std::cerr << "Can't write " << result["output"].as<std::string>() << std::endl;
+            return -1;
+        }
+    } else {
+        std::cout << json;
+    }
+
+    return ok ? 0 : -1;
+}
@@ -20,19 +20,25 @@
  ****************************************************************************/
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <iostream>
+#include <type_traits>
 
 #include <assert.h>
 
 namespace queens {
 class Board {
     public:
+        // Largest supported board size, the masks of the columns and rows are 32 bits wide in mini_board
+        static constexpr unsigned MAX_N = 32;
+
         uint8_t const N;
         uint8_t placed;
 
     private:
-        int8_t *const board;
+        // Row of the queen in each column, -1 if the column is empty. Fixed size, so copies never allocate.
+        std::array<int8_t, MAX_N> board;
 
         uint64_t bv;
         uint64_t bh;
@@ -40,18 +46,9 @@ class Board {
         uint64_t bd;
 
     public:
-        Board(unsigned const dim) : N(dim), placed(0), board(new int8_t[N]), bv(0), bh(0), bu(0), bd(0) {
-            for (uint8_t i = 0; i < N; i++) {
-                board[i] = -1;
-            }
-        }
-        ~Board() { delete[] board; }
-        Board(Board const &other)
-            : N(other.N), placed(other.placed), board(new int8_t[N]), bv(other.bv), bh(other.bh), bu(other.bu),
-              bd(other.bd) {
-            for (uint8_t i = 0; i < N; i++) {
-                board[i] = other.board[i];
-            }
+        Board(unsigned const dim) : N(dim), placed(0), bv(0), bh(0), bu(0), bd(0) {
+            assert(dim <= MAX_N);
+            board.fill(-1);
         }
 
     private:
@@ -186,6 +183,8 @@ class Board {
 
 }; // class Board
 
+static_assert(std::is_trivially_copyable_v<Board>, "Preplacements are copied per work unit");
+
 inline std::ostream &operator<<(std::ostream &out, Board const &brd) {
     uint8_t const N = brd.N;
     for (uint8_t y = N; y-- > 0;) {
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace queens {
+/**
+ * @brief Bounded lock-free multi producer multi consumer queue.
+ *
+ * Every cell carries a sequence number that tells producers and consumers whether the cell is free or filled for
+ * the current lap around the ring, see Dmitry Vyukov's bounded MPMC queue.
+ */
+template <typename T> class bounded_queue {
+        struct cell {
+                std::atomic<size_t> sequence;
+                T data;
+        };
+
+        // Keep producer and consumer positions on separate cache lines
+        static constexpr size_t CACHE_LINE = 64;
+
+        std::unique_ptr<cell[]> const m_cells;
+        size_t const m_mask;
+        alignas(CACHE_LINE) std::atomic<size_t> m_enqueue_pos{0};
+        alignas(CACHE_LINE) std::atomic<size_t> m_dequeue_pos{0};
+
+    public:
+        /**
+         * @param capacity Number of elements the queue can hold, must be a power of two
+         */
+        explicit bounded_queue(size_t capacity) : m_cells{new cell[capacity]}, m_mask{capacity - 1} {
+            assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+            for (size_t i = 0; i < capacity; i++) {
+                m_cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        size_t capacity() const { return m_mask + 1; }
+
+        /**
+         * @brief Append an element.
+         * @return false if the queue is full, true otherwise.
+         */
+        bool try_push(T const &data) {
+            size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                cell &c = m_cells[pos & m_mask];
+                size_t const seq = c.sequence.load(std::memory_order_acquire);
+                intptr_t const diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        c.data = data;
+                        c.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = m_enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Take the oldest element.
+         * @return false if the queue is empty, true otherwise.
+         */
+        bool try_pop(T &data) {
+            size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            for (;;) {
+                cell &c = m_cells[pos & m_mask];
+                size_t const seq = c.sequence.load(std::memory_order_acquire);
+                intptr_t const diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        data = c.data;
+                        c.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = m_dequeue_pos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+};
+} // namespace queens
@@ -0,0 +1,20 @@
+# Fail unless every global symbol the object defines starts with PREFIX, see the engines in CMakeLists.txt.
+# Usage: cmake -DNM=<nm> -DOBJECT=<object> -DPREFIX=<mangled namespace> -P check_linkage.cmake
+execute_process(COMMAND ${NM} --defined-only --extern-only --format=posix ${OBJECT}
+    OUTPUT_VARIABLE symbols RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Can't list the symbols of ${OBJECT}")
+endif()
+
+string(REPLACE "\n" ";" symbols "${symbols}")
+set(leaked)
+foreach (line IN LISTS symbols)
+    string(REGEX MATCH "^[^ ]+" symbol "${line}")
+    if (symbol AND NOT symbol MATCHES "^${PREFIX}")
+        list(APPEND leaked ${symbol})
+    endif()
+endforeach()
+if (leaked)
+    list(JOIN leaked "\n  " leaked)
+    message(FATAL_ERROR "${OBJECT} exports symbols outside of its namespace:\n  ${leaked}")
+endif()
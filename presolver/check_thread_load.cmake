@@ -0,0 +1,19 @@
+# Fail unless the instrumentation reports one busy thread per solver thread, so the engines and the driver count into
+# the same per thread counters.
+# Usage: cmake -DPRESOLVER=<m-queens3-presolver> -DTHREADS=<threads> -P check_thread_load.cmake
+execute_process(COMMAND ${PRESOLVER} -N 12 -t ${THREADS} --progress 0
+    OUTPUT_VARIABLE output RESULT_VARIABLE result)
+if (NOT result EQUAL 0 OR NOT output MATCHES "\nPASS\n")
+    message(FATAL_ERROR "The solve failed:\n${output}")
+endif()
+
+string(REGEX MATCHALL "\n \\[[0-9]+\\] busy [^\n]*" rows "${output}")
+list(LENGTH rows count)
+if (NOT count EQUAL THREADS)
+    message(FATAL_ERROR "Expected ${THREADS} threads in the load report, got ${count}:${rows}")
+endif()
+foreach (row IN LISTS rows)
+    if (row MATCHES "busy 0 s")
+        message(FATAL_ERROR "A thread of the load report was never busy:${row}")
+    endif()
+endforeach()
@@ -0,0 +1,194 @@
+#include "chunk_solver.hpp"
+
+#include "instrument.hpp"
+#include "split_queue.hpp"
+#include "subproblem.hpp"
+#include "work_pool.hpp"
+#include <algorithm>
+#include <chrono>
+
+using namespace queens;
+
+solve_outcome queens::solve_chunks(solve_plan const &plan, solve_hooks const &hooks) {
+    std::vector<chunk_ref> const &chunks = plan.chunks;
+    solve_outcome outcome;
+    outcome.seconds.assign(plan.time_chunks ? chunks.size() : 0, -1);
+
+    auto symmetry = [&](size_t index) { return Symmetry{static_cast<Symmetry::Direction>(chunks[index].sym)}; };
+    // Work units of a chunk, the last one of a symmetry class may be short
+    auto chunk_units = [&](size_t index) {
+        size_t const first = chunks[index].chunk * SOLVE_CHUNK;
+        return std::min(SOLVE_CHUNK, plan.work[symmetry(index)].size() - first);
+    };
+
+    // Per worker results, padded so workers never share a cache line
+    struct alignas(64) worker_counts {
+            std::array<uint64_t, ALL_SYMMETRIES.size()> counts{};
+    };
+    work_pool pool{chunks.size(), plan.threads, plan.placement};
+    std::vector<worker_counts> worker_results(pool.workers());
+    // Deal the chunks to the workers, so every worker starts with the first chunks left
+    std::vector<uint32_t> const rank{work_pool::ranks(chunks.size(), pool.workers())};
+
+    // With more than one node, the units of the tasks each node starts with are copied to memory of that node, first
+    // touched by a thread pinned to it, in the form they are stored in. Only stolen tasks are then read from another
+    // node.
+    struct node_copy {
+            std::vector<mini_board> boards;
+            std::vector<packed_unit> packed;
+    };
+    std::vector<node_copy> node_units;
+    // Units of each task in node_units, empty if the units are read from the plan
+    std::vector<unit_span> task_units;
+    if (plan.topology.nodes.size() > 1) {
+        auto const copy_start = std::chrono::steady_clock::now();
+        node_units.resize(plan.topology.nodes.size());
+        task_units.resize(chunks.size());
+        for_each_node(plan.topology, [&](unsigned n) {
+            // The workers of a node are consecutive, so are the ranges of tasks they start with
+            auto const on_node = [&](worker_placement const &p) { return p.node == n; };
+            unsigned const first_worker = std::find_if(plan.placement.begin(), plan.placement.end(), on_node) -
+                                          plan.placement.begin();
+            unsigned const last_worker = std::find_if_not(plan.placement.begin() + first_worker,
+                                                          plan.placement.end(), on_node) -
+                                         plan.placement.begin();
+            size_t const first_task = pool.first_task(first_worker);
+            size_t const last_task = pool.first_task(last_worker);
+
+            std::vector<size_t> offset;
+            node_copy &units = node_units[n];
+            for (size_t task = first_task; task < last_task; task++) {
+                size_t const first = chunks[rank[task]].chunk * SOLVE_CHUNK;
+                unit_span const sym_units{plan.work[symmetry(rank[task])].subspan(first, chunk_units(rank[task]))};
+                if (sym_units.packed()) {
+                    offset.push_back(units.packed.size());
+                    units.packed.insert(units.packed.end(), sym_units.packed_units().begin(),
+                                        sym_units.packed_units().end());
+                } else {
+                    offset.push_back(units.boards.size());
+                    units.boards.insert(units.boards.end(), sym_units.boards().begin(), sym_units.boards().end());
+                }
+            }
+            for (size_t task = first_task; task < last_task; task++) {
+                size_t const at = offset[task - first_task];
+                size_t const count = chunk_units(rank[task]);
+                if (plan.work[symmetry(rank[task])].packed()) {
+                    task_units[task] = {std::span<packed_unit const>{units.packed}.subspan(at, count), plan.boardsize,
+                                        plan.ring_width};
+                } else {
+                    task_units[task] = std::span<mini_board const>{units.boards}.subspan(at, count);
+                }
+            }
+        });
+        if (hooks.copied) {
+            hooks.copied(std::chrono::duration<double>(std::chrono::steady_clock::now() - copy_start).count());
+        }
+    }
+
+    // Count the completions of a chunk once all of them are known
+    auto finish = [&](unsigned worker, size_t index, uint64_t completions) {
+        if (hooks.solved) {
+            hooks.solved(symmetry(index), chunks[index].chunk, chunk_units(index), completions);
+        }
+        worker_results[worker].counts[symmetry(index)] += completions;
+    };
+    auto visited = [&](size_t index, uint64_t nodes) {
+        if (hooks.visited) {
+            hooks.visited(symmetry(index), nodes);
+        }
+    };
+
+    // With splitting, the last solve of a chunk or of one of its subproblems finishes the chunk
+    split_queue splits{pool.workers()};
+    std::vector<split_group> groups(plan.split_budget == 0 ? 0 : chunks.size());
+    auto add_split = [&](unsigned worker, split_group &group, uint64_t completions) {
+        group.completions.fetch_add(completions, std::memory_order_relaxed);
+        if (split_queue::complete(group)) {
+            finish(worker, &group - groups.data(), group.completions.load(std::memory_order_relaxed));
+        }
+    };
+
+    auto solve_chunk = [&](unsigned worker, size_t task) {
+        size_t const index = rank[task];
+        Symmetry const sym{symmetry(index)};
+        if (hooks.done && hooks.done(sym, chunks[index].chunk)) {
+            return;
+        }
+
+        std::span<uint32_t const> const occ{plan.occurrences[sym]};
+        size_t const first = chunks[index].chunk * SOLVE_CHUNK;
+        size_t const count = chunk_units(index);
+        // Packed units are decoded here, so they stay packed in memory until they are solved
+        std::array<mini_board, SOLVE_CHUNK> decoded;
+        mini_board const *const units = task_units.empty() ? plan.work[sym].decode(first, count, decoded.data())
+                                                           : task_units[task].decode(0, count, decoded.data());
+        std::array<uint64_t, SOLVE_CHUNK> out;
+        uint64_t c_counts = 0;
+        uint64_t nodes = 0;
+        {
+            instrument::busy_timer const busy;
+            auto const chunk_start = std::chrono::steady_clock::now();
+            if (plan.split_budget == 0) {
+                nodes = plan.engine(units, count, plan.boardsize, plan.ring_width, out.data());
+                for (size_t i = 0; i < count; i++) {
+                    c_counts += occ.empty() ? out[i] : out[i] * occ[first + i];
+                }
+            } else {
+                split_sink sink{splits};
+                try {
+                    for (size_t i = 0; i < count; i++) {
+                        uint32_t const weight = occ.empty() ? 1 : occ[first + i];
+                        sink.start(groups[index], weight);
+                        c_counts += plan.isa->split(subproblem::from(units[i], plan.boardsize, plan.ring_width),
+                                                    plan.split_budget, sink, nodes) *
+                                    weight;
+                    }
+                } catch (...) {
+                    splits.abort();
+                    throw;
+                }
+            }
+            if (plan.time_chunks) {
+                outcome.seconds[index] =
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - chunk_start).count();
+            }
+        }
+        visited(index, nodes);
+        if (plan.split_budget == 0) {
+            finish(worker, index, c_counts);
+        } else {
+            add_split(worker, groups[index], c_counts);
+        }
+    };
+
+    // Subproblems split off long running work units, solved once a worker has no chunks left
+    auto solve_splits = [&](unsigned worker) {
+        if (plan.split_budget == 0) {
+            return;
+        }
+        split_sink sink{splits};
+        try {
+            for (split_task task; splits.pop(task);) {
+                instrument::busy_timer const busy;
+                sink.start(*task.group, task.weight);
+                uint64_t nodes = 0;
+                uint64_t const completions = plan.isa->split(task.sub, plan.split_budget, sink, nodes);
+                visited(task.group - groups.data(), nodes);
+                add_split(worker, *task.group, completions * task.weight);
+            }
+        } catch (...) {
+            splits.abort();
+            throw;
+        }
+    };
+
+    pool.run(solve_chunk, solve_splits);
+
+    for (worker_counts const &w : worker_results) {
+        for (size_t i = 0; i < outcome.counts.size(); i++) {
+            outcome.counts[i] += w.counts[i];
+        }
+    }
+    outcome.split_off = splits.published();
+    return outcome;
+}
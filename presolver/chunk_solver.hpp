@@ -0,0 +1,79 @@
+#pragma once
+
+#include "engines.hpp"
+#include "mini_board.hpp"
+#include "numa.hpp"
+#include "packed_unit.hpp"
+#include "solver_engine.hpp"
+#include "symmetry.hpp"
+#include "work_order.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief Work units of a solve and how they are spread over the threads, see solve_chunks().
+ */
+struct solve_plan {
+        isa_variant const *isa;
+        SolverEngine engine;
+        uint8_t boardsize;
+        uint8_t ring_width;
+        // Work units per symmetry class, packed ones are decoded a chunk at a time by the threads
+        std::array<unit_span, ALL_SYMMETRIES.size()> work;
+        // Number of work units each unit stands for after dedup, empty if every unit stands for itself
+        std::array<std::span<uint32_t const>, ALL_SYMMETRIES.size()> occurrences;
+        // Chunks in the order they are solved, see list_chunks()
+        std::vector<chunk_ref> chunks;
+        unsigned threads;
+        // Search states after which work units are split while threads are idle, 0 disables splitting
+        uint64_t split_budget{0};
+        // NUMA nodes and the node and CPU of every thread, see place_workers(), empty to leave the threads unpinned
+        numa_topology topology;
+        std::vector<worker_placement> placement;
+        // Measure the seconds each chunk takes
+        bool time_chunks{false};
+};
+
+/**
+ * @brief Callbacks of solve_chunks(), each one may be empty. All but copied are called by the worker threads.
+ */
+struct solve_hooks {
+        // True for chunks which are solved already, like the ones restored from a journal, they are skipped
+        std::function<bool(Symmetry sym, size_t chunk)> done;
+        // A chunk is solved, units is the number of work units in it, completions are weighted by the occurrences
+        std::function<void(Symmetry sym, size_t chunk, size_t units, uint64_t completions)> solved;
+        // Search states the engine visited for work units of a symmetry class, see SolverEngine
+        std::function<void(Symmetry sym, uint64_t nodes)> visited;
+        // The work units were copied to their NUMA nodes, the spans of the plan are not read anymore
+        std::function<void(double seconds)> copied;
+};
+
+/**
+ * @brief Result of solve_chunks().
+ */
+struct solve_outcome {
+        // Completions of the solved chunks per symmetry class, weighted by the occurrences but not by the symmetry
+        std::array<uint64_t, ALL_SYMMETRIES.size()> counts{};
+        // Seconds each chunk took in the order of the chunks of the plan, negative for skipped chunks, empty unless
+        // timed
+        std::vector<double> seconds;
+        // Subproblems split off long running work units
+        uint64_t split_off{0};
+};
+
+/**
+ * @brief Solve the chunks of a plan on a work_pool, the way the presolver solves stored work units.
+ *
+ * The chunks are dealt to the threads in their order, so every thread starts with the first ones left. With more
+ * than one NUMA node, the units of the chunks each node starts with are copied to memory of that node first. Throws
+ * std::runtime_error if the threads can't be pinned, and rethrows the first exception of a hook.
+ */
+solve_outcome solve_chunks(solve_plan const &plan, solve_hooks const &hooks = {});
+
+} // namespace queens
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+/**
+ * Entry points of the command line programs. Each has its own executable and is a subcommand of m-queens3.
+ */
+namespace queens {
+
+/**
+ * @brief Generate, verify and solve work units, see --help.
+ * @param program Name of the program shown in the usage
+ * @return Exit code of the program
+ */
+int presolver_main(std::string const &program, int argc, char *argv[]);
+
+/**
+ * @brief Benchmark the preplacement and the solver engines, see --help.
+ * @param program Name of the program shown in the usage
+ * @return Exit code of the program
+ */
+int benchmark_main(std::string const &program, int argc, char *argv[]);
+
+} // namespace queens
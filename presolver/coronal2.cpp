@@ -22,171 +22,514 @@
 // #undef TRACE
 // #define TRACE
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstdint>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <initializer_list>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string.h>
+#include <utility>
+#include <vector>
 
 #include "coronal2.hpp"
 #include "symmetry.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace queens;
 
-void preplace(unsigned N, std::function<PreplaceCallback> callback) {
-    std::cout << N << "-Queens Puzzle preplacement generator\n" << std::endl;
+/**
+ * All valid placements of one queen in each of k adjacent columns (rows), in lexicographic order of the rows
+ * (columns) they are placed in. Mirroring a placement maps index idx to count-1-idx.
+ */
+class side_placements {
+        unsigned const m_width;
+        std::vector<uint8_t> m_rows;
+        std::vector<unsigned> m_skip;
 
-    /**
-     * The number of valid pre-placements in two adjacent columns (rows) is
-     * 2*(N-2) + (N-2)*(N-3) for the outmost and inner positions in the the
-     * first column, respectively. Thus, the total is (N-2)*(N-1).
-     */
-    struct pres_t {
-            char unsigned a;
-            char unsigned b;
-    };
-    std::unique_ptr<pres_t[]> pres(new pres_t[(N - 2) * (N - 1)]);
-
-    { // Compute all valid two-column pre-placements in order:
-        // (a0, b0) < (a1, b1) if a0<a1 || (a0==a1 && b0<b1)
-        unsigned idx = 0;
-        for (unsigned a = 0; a < N; a++) {
-            for (unsigned b = 0; b < N; b++) {
-                if (abs(static_cast<signed>(a) - static_cast<signed>(b)) <= 1)
-                    continue;
-                pres[idx].a = a;
-                pres[idx].b = b;
-                idx++;
+    public:
+        side_placements(unsigned N, unsigned width) : m_width{width} {
+            std::vector<uint8_t> rows(width);
+            enumerate(N, rows, 0);
+
+            // For every placement and position i, find the next placement which differs in the positions 0..i
+            unsigned const cnt = count();
+            m_skip.resize(m_rows.size());
+            for (unsigned i = 0; i < width; i++) {
+                m_skip[(cnt - 1) * width + i] = cnt;
+            }
+            for (unsigned idx = cnt - 1; idx-- > 0;) {
+                bool same = true;
+                for (unsigned i = 0; i < width; i++) {
+                    same &= m_rows[idx * width + i] == m_rows[(idx + 1) * width + i];
+                    m_skip[idx * width + i] = same ? m_skip[(idx + 1) * width + i] : idx + 1;
+                }
+            }
+        }
+
+        unsigned width() const { return m_width; }
+        unsigned count() const { return m_rows.size() / m_width; }
+        uint8_t const *operator[](unsigned idx) const { return &m_rows[idx * m_width]; }
+
+        /**
+         * @brief Index of the next placement after idx which differs in any of the positions 0..i
+         */
+        unsigned skip(unsigned idx, unsigned i) const { return m_skip[idx * m_width + i]; }
+
+    private:
+        void enumerate(unsigned N, std::vector<uint8_t> &rows, unsigned col) {
+            if (col == m_width) {
+                m_rows.insert(m_rows.end(), rows.begin(), rows.end());
+                return;
+            }
+            for (unsigned a = 0; a < N; a++) {
+                bool valid = true;
+                for (unsigned c = 0; c < col; c++) {
+                    unsigned const dist = abs(static_cast<signed>(a) - static_cast<signed>(rows[c]));
+                    // Same row or same diagonal as a queen in a previous column
+                    valid &= dist != 0 && dist != col - c;
+                }
+                if (valid) {
+                    rows[col] = a;
+                    enumerate(N, rows, col + 1);
+                }
             }
         }
-        assert(idx == (N - 2) * (N - 1)); // Wrong number of pre-placements
+};
+
+enum class Side { WEST, NORTH, EAST, SOUTH };
+
+/**
+ * @brief Place the queens of one side and call cont with all of them on the board.
+ *
+ * Each side is the west side rotated clockwise by 90° steps, the queen in the i-th outermost column (row) of the
+ * side is placed in row (column) rows[i] counted clockwise.
+ * @return Position of the first queen which can't be placed, or the width of the side if all could be placed
+ */
+template <Side S, typename Cont>
+static unsigned place_side(Board &board, uint8_t const *rows, unsigned i, unsigned width, Cont &&cont) {
+    if (i == width) {
+        cont();
+        return width;
+    }
+
+    unsigned const N = board.N;
+    unsigned const a = rows[i];
+    unsigned x;
+    unsigned y;
+    if constexpr (S == Side::WEST) {
+        x = i;
+        y = a;
+    } else if constexpr (S == Side::NORTH) {
+        x = a;
+        y = N - 1 - i;
+    } else if constexpr (S == Side::EAST) {
+        x = N - 1 - i;
+        y = N - 1 - a;
+    } else {
+        x = N - 1 - a;
+        y = i;
     }
-    std::cout << "First side bound: (" << (unsigned)pres[(N / 2) * (N - 3)].a << ", "
-              << (unsigned)pres[(N / 2) * (N - 3)].b << ") / (" << (unsigned)pres[(N / 2) * (N - 3) + 1].a << ", "
-              << (unsigned)pres[(N / 2) * (N - 3) + 1].b << ')' << std::endl;
 
-    // Generate coronal Placements
-    Board board(N);
-    for (unsigned w = 0; w <= (N / 2) * (N - 3); w++) {
-        unsigned const wa = pres[w].a;
-        unsigned const wb = pres[w].b;
+    Board::Placement p(board.place(x, y));
+    if (!p) {
+        return i;
+    }
+    return place_side<S>(board, rows, i + 1, width, cont);
+}
+
 #ifdef TRACE
-        std::cerr << '(' << wa << ", " << wb << ')' << std::endl;
-#else
-        std::cout << "\rProgress: " << w << '/' << ((N / 2) * (N - 3)) << std::flush;
+static void trace(side_placements const &pres, std::initializer_list<unsigned> sides) {
+    for (unsigned idx : sides) {
+        std::cerr << '(';
+        for (unsigned i = 0; i < pres.width(); i++) {
+            std::cerr << (i ? ", " : "") << unsigned{pres[idx][i]};
+        }
+        std::cerr << ')';
+    }
+    std::cerr << std::endl;
+}
 #endif
 
-        Board::Placement pwa(board.place(0, wa));
-        Board::Placement pwb(board.place(1, wb));
-        assert(pwa && pwb); // NO conflicts on first side possible
+/**
+ * @brief Hand a complete pre-placement to emit if it is the canonical minimum of its symmetry class.
+ */
+template <typename Emit>
+static void emit_canonical(unsigned total, unsigned w, unsigned n, unsigned e, unsigned s, Board const &board,
+                           Emit &&emit) {
+    // We have a successful complete pre-placement with
+    //   w <= n, e, s < total-w
+    //
+    // Thus, the placement is definitely a canonical minimum unless
+    // one or more of n, e, s are equal to w or total-1-w.
+
+    { // Check for minimum if n, e, s = total-1-w
+        unsigned const ww = total - 1 - w;
+        if (s == ww) {
+            // check if flip about the up diagonal is smaller
+            if (n < total - 1 - e) {
+                return;
+            }
+        }
+        if (e == ww) {
+            // check if flip about the vertical center is smaller
+            if (n > total - 1 - n) {
+                return;
+            }
+        }
+        if (n == ww) {
+            // check if flip about the down diagonal is smaller
+            if (e > total - 1 - s) {
+                return;
+            }
+        }
+    }
+
+    // Check for minimum if n, e, s = w
+    if (s == w) {
+        // right rotation is smaller unless  w = n = e = s
+        if ((n != w) || (e != w)) {
+            return;
+        }
+
+        emit(board, Symmetry::Direction::ROTATE);
+        return;
+    }
+    if (e == w) {
+        // check if 180°-rotation is smaller
+        if (n >= s) {
+            if (n > s) {
+                return;
+            }
+            emit(board, Symmetry::Direction::POINT);
+            return;
+        }
+    }
+    // n = w is okay
+
+    emit(board, Symmetry::Direction::NONE);
+}
+
+/**
+ * @brief Generate all canonical coronal placements for one placement w of the first and n of the second side.
+ * @param board Empty board, it is empty again on return
+ * @param emit Called for each preplacement, with the same parameters as PreplaceCallback
+ * @return Next placement of the second side which may give preplacements
+ */
+template <typename Emit>
+static unsigned preplace_wn(side_placements const &pres, unsigned w, unsigned n, Board &board, Emit &&emit) {
+    unsigned const width = pres.width();
+    unsigned const total = pres.count();
+    unsigned next_n = n + 1;
 
-        for (unsigned n = w; n < (N - 2) * (N - 1) - w; n++) {
-            unsigned const na = pres[n].a;
-            unsigned const nb = pres[n].b;
+    [[maybe_unused]] unsigned const placed_w = place_side<Side::WEST>(board, pres[w], 0, width, [&]() {
+#ifdef TRACE
+        trace(pres, {w, n});
+#endif
+        unsigned const placed_n = place_side<Side::NORTH>(board, pres[n], 0, width, [&]() {
+            for (unsigned e = w; e < total - w;) {
 #ifdef TRACE
-            std::cerr << '(' << wa << ", " << wb << ')' << '(' << na << ", " << nb << ')' << std::endl;
+                trace(pres, {w, n, e});
 #endif
+                unsigned const placed_e = place_side<Side::EAST>(board, pres[e], 0, width, [&]() {
+                    for (unsigned s = w; s < total - w;) {
+#ifdef TRACE
+                        trace(pres, {w, n, e, s});
+#endif
+                        unsigned const placed_s = place_side<Side::SOUTH>(board, pres[s], 0, width, [&]() {
+                            emit_canonical(total, w, n, e, s, board, emit);
+                        });
+                        // Placements sharing the conflicting prefix fail the same way
+                        s = placed_s == width ? s + 1 : pres.skip(s, placed_s);
+                    } // s
+                });
+                e = placed_e == width ? e + 1 : pres.skip(e, placed_e);
+            } // e
+        });
+        next_n = placed_n == width ? n + 1 : pres.skip(n, placed_n);
+    });
+    assert(placed_w == width); // NO conflicts on first side possible
+    return next_n;
+}
 
-            Board::Placement pna(board.place(na, N - 1));
-            if (!pna)
-                continue;
-            Board::Placement pnb(board.place(nb, N - 2));
-            if (!pnb)
-                continue;
+/**
+ * @brief Generate all canonical coronal placements for one first side placement w.
+ * @param board Empty board, it is empty again on return
+ * @param emit Called for each preplacement, with the same parameters as PreplaceCallback
+ */
+template <typename Emit>
+static void preplace_w(side_placements const &pres, unsigned w, Board &board, Emit &&emit) {
+    for (unsigned n = w; n < pres.count() - w;) {
+        n = preplace_wn(pres, w, n, board, emit);
+    }
+}
 
-            for (unsigned e = w; e < (N - 2) * (N - 1) - w; e++) {
-                unsigned const ea = pres[e].a;
-                unsigned const eb = pres[e].b;
-#ifdef TRACE
-                std::cerr << '(' << wa << ", " << wb << ')' << '(' << na << ", " << nb << ')' << '(' << ea << ", " << eb
-                          << ')' << std::endl;
+/**
+ * @brief Last placement of the first side which can be the canonical minimum of a preplacement.
+ */
+static unsigned first_side_bound(side_placements const &pres, unsigned N) {
+    // The first side is the canonical minimum, so its outmost queen is in the lower half. For odd N it is not in the
+    // center either, the four outmost queens can't all be in the center of their sides.
+    unsigned last_w = 0;
+    while (pres[last_w + 1][0] < N / 2) {
+        last_w++;
+    }
+    return last_w;
+}
+
+size_t preplace_buffer_bytes() {
+#ifdef _OPENMP
+    size_t const threads = omp_get_max_threads();
+#else
+    size_t const threads = 1;
 #endif
+    return threads * PREPLACE_BATCH * sizeof(std::pair<Board, Symmetry::Direction>);
+}
 
-                Board::Placement pea(board.place(N - 1, N - 1 - ea));
-                if (!pea)
-                    continue;
-                Board::Placement peb(board.place(N - 2, N - 1 - eb));
-                if (!peb)
-                    continue;
+void preplace_batches(unsigned N, std::function<void(PreplaceBatch)> const &callback, unsigned ring_width) {
+    std::cout << N << "-Queens Puzzle preplacement generator, ring width " << ring_width << '\n' << std::endl;
+    assert(ring_width >= 2 && 2 * ring_width < N);
 
-                for (unsigned s = w; s < (N - 2) * (N - 1) - w; s++) {
-                    unsigned const sa = pres[s].a;
-                    unsigned const sb = pres[s].b;
+    /**
+     * For a ring width of 2, the number of valid pre-placements in two adjacent columns (rows) is
+     * 2*(N-2) + (N-2)*(N-3) for the outmost and inner positions in the the
+     * first column, respectively. Thus, the total is (N-2)*(N-1).
+     */
+    side_placements const pres(N, ring_width);
+    assert(ring_width != 2 || pres.count() == (N - 2) * (N - 1)); // Wrong number of pre-placements
+
+    unsigned const last_w = first_side_bound(pres, N);
+
+    auto print_side = [&](unsigned idx) {
+        std::cout << '(';
+        for (unsigned i = 0; i < ring_width; i++) {
+            std::cout << (i ? ", " : "") << unsigned{pres[idx][i]};
+        }
+        std::cout << ')';
+    };
+    std::cout << "First side bound: ";
+    print_side(last_w);
+    std::cout << " / ";
+    print_side(last_w + 1);
+    std::cout << std::endl;
+
+    // Generate coronal Placements. Each thread owns a board and solves whole w. The callback gets the preplacements
+    // in the order of w, so the output is the same as with one thread: the thread whose w is next hands out each
+    // full batch right away, the others wait for their turn once their batch is full. So each thread holds at most
+    // one batch of PREPLACE_BATCH preplacements.
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+    std::mutex turn_lock;
+    std::condition_variable turn_changed;
+    unsigned turn = 0; // The w whose preplacements go to the callback next
 #ifdef TRACE
-                    std::cerr << '(' << wa << ", " << wb << ')' << '(' << na << ", " << nb << ')' << '(' << ea << ", "
-                              << eb << ')' << '(' << sa << ", " << sb << ')' << std::endl;
+#pragma omp parallel if (false)
+#else
+#pragma omp parallel
 #endif
+    {
+        Board board(N);
+        std::vector<std::pair<Board, Symmetry::Direction>> found;
+        found.reserve(PREPLACE_BATCH);
 
-                    Board::Placement psa(board.place(N - 1 - sa, 0));
-                    if (!psa)
-                        continue;
-                    Board::Placement psb(board.place(N - 1 - sb, 1));
-                    if (!psb)
-                        continue;
-
-                    // We have a successful complete pre-placement with
-                    //   w <= n, e, s < (N-2)*(N-1)-w
-                    //
-                    // Thus, the placement is definitely a canonical minimum unless
-                    // one or more of n, e, s are equal to w or (N-2)*(N-1)-1-w.
-
-                    { // Check for minimum if n, e, s = (N-2)*(N-1)-1-w
-                        unsigned const ww = (N - 2) * (N - 1) - 1 - w;
-                        if (s == ww) {
-                            // check if flip about the up diagonal is smaller
-                            if (n < (N - 2) * (N - 1) - 1 - e) {
-                                // print('S', wa, wb, na, nb, ea, eb, sa, sb);
-                                continue;
-                            }
-                        }
-                        if (e == ww) {
-                            // check if flip about the vertical center is smaller
-                            if (n > (N - 2) * (N - 1) - 1 - n) {
-                                // print('E', wa, wb, na, nb, ea, eb, sa, sb);
-                                continue;
-                            }
-                        }
-                        if (n == ww) {
-                            // check if flip about the down diagonal is smaller
-                            if (e > (N - 2) * (N - 1) - 1 - s) {
-                                // print('N', wa, wb, na, nb, ea, eb, sa, sb);
-                                continue;
-                            }
-                        }
-                    }
-
-                    // Check for minimum if n, e, s = w
-                    if (s == w) {
-                        // right rotation is smaller unless  w = n = e = s
-                        if ((n != w) || (e != w)) {
-                            // print('s', wa, wb, na, nb, ea, eb, sa, sb);
-                            continue;
-                        }
+        // Wait for the turn of w and hand out the buffered preplacements
+        auto hand_out = [&](unsigned w) {
+            std::unique_lock<std::mutex> lock{turn_lock};
+            turn_changed.wait(lock, [&] { return turn == w; });
+            lock.unlock();
+            // Exceptions must not leave the parallel region, keep the first one and stop calling back
+            try {
+                if (!failed.load(std::memory_order_relaxed) && !found.empty()) {
+                    callback(found);
+                }
+            } catch (...) {
+                error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+            found.clear();
+        };
 
-                        callback(board, Symmetry::Direction::ROTATE);
-                        continue;
+#pragma omp for schedule(dynamic, 1)
+        for (unsigned w = 0; w <= last_w; w++) {
+            // Nobody takes the preplacements after an error
+            if (!failed.load(std::memory_order_relaxed)) {
+                preplace_w(pres, w, board, [&](Board const &brd, Symmetry::Direction sym) {
+                    found.emplace_back(brd, sym);
+                    if (found.size() == PREPLACE_BATCH) {
+                        hand_out(w);
                     }
-                    if (e == w) {
-                        // check if 180°-rotation is smaller
-                        if (n >= s) {
-                            if (n > s) {
-                                // print('e', wa, wb, na, nb, ea, eb, sa, sb);
-                                continue;
-                            }
-                            callback(board, Symmetry::Direction::POINT);
-                            continue;
-                        }
-                    }
-                    // n = w is okay
+                });
+            }
+            hand_out(w);
 
-                    // print('o', wa, wb, na, nb, ea, eb, sa, sb);
-                    callback(board, Symmetry::Direction::NONE);
-                } // s
-            }     // e
-        }         // n
-    }             // w
+#ifndef TRACE
+            std::cout << "\rProgress: " << w << '/' << last_w << std::flush;
+#endif
+            {
+                std::lock_guard<std::mutex> guard{turn_lock};
+                turn = w + 1;
+            }
+            turn_changed.notify_all();
+        }
+    }
 
     std::cout << std::endl;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+preplacement_generator::preplacement_generator(unsigned N, unsigned ring_width)
+    : m_pres{std::make_unique<side_placements const>(N, ring_width)}, m_last_w{first_side_bound(*m_pres, N)},
+      m_board(N), m_w_units(m_last_w + 1, UNKNOWN) {
+    assert(ring_width >= 2 && 2 * ring_width < N);
+}
+
+preplacement_generator::~preplacement_generator() = default;
+
+void preplacement_generator::seek(position pos) {
+    m_pos = pos;
+    m_step_ready = false;
+    if (done()) {
+        if (m_pos.w != m_last_w + 1 || m_pos.n != m_pos.w || m_pos.offset != 0) {
+            throw std::runtime_error("Invalid preplacement position");
+        }
+        return;
+    }
+    if (m_pos.n < m_pos.w || m_pos.n >= m_pres->count() - m_pos.w) {
+        throw std::runtime_error("Invalid preplacement position");
+    }
+    fill_step();
+    if (m_pos.offset > m_step.size()) {
+        throw std::runtime_error("Invalid preplacement position");
+    }
+    if (m_pos.offset == m_step.size()) {
+        next_step();
+    }
+}
+
+uint64_t preplacement_generator::skip(uint64_t count) {
+    uint64_t skipped = 0;
+    // Units skipped before the current w, UNKNOWN unless this skip started at its first step
+    uint64_t w_start = UNKNOWN;
+    // A whole w was skipped step by step, so the skip is long enough to count the next ones ahead
+    bool ahead = false;
+    while (skipped < count && !done()) {
+        uint64_t const left = count - skipped;
+        if (m_pos.n == m_pos.w && m_pos.offset == 0) {
+            if (ahead) {
+                count_ahead(m_pos.w);
+            }
+            uint64_t const in_w = m_w_units[m_pos.w];
+            if (in_w != UNKNOWN && in_w <= left) {
+                skipped += in_w;
+                m_pos = {m_pos.w + 1, m_pos.w + 1, 0};
+                m_step_ready = false;
+                continue;
+            }
+            w_start = skipped;
+        }
+
+        // Whole steps are counted without storing their units, only the step the skip ends in is generated
+        unsigned const w = m_pos.w;
+        if (!m_step_ready) {
+            unsigned next_n;
+            uint64_t const in_step = units_of_step(next_n);
+            if (in_step <= left) {
+                skipped += in_step;
+                m_next_n = next_n;
+                next_step();
+                if (m_pos.w != w && w_start != UNKNOWN) {
+                    m_w_units[w] = skipped - w_start;
+                    ahead = true;
+                }
+                continue;
+            }
+        }
+        fill_step();
+        size_t const cnt = std::min<uint64_t>(left, m_step.size() - m_pos.offset);
+        m_pos.offset += cnt;
+        skipped += cnt;
+        if (m_pos.offset == m_step.size()) {
+            next_step();
+        }
+    }
+    return skipped;
+}
+
+size_t preplacement_generator::pull(std::vector<unit> &out, size_t max) {
+    size_t taken = 0;
+    while (taken < max && !done()) {
+        fill_step();
+        size_t const cnt = std::min(max - taken, m_step.size() - m_pos.offset);
+        // Board can't be assigned, only copied, so no range insert
+        for (size_t i = m_pos.offset; i < m_pos.offset + cnt; i++) {
+            out.push_back(m_step[i]);
+        }
+        m_pos.offset += cnt;
+        taken += cnt;
+        if (m_pos.offset == m_step.size()) {
+            next_step();
+        }
+    }
+    return taken;
+}
+
+void preplacement_generator::count_ahead(unsigned first) {
+#ifdef _OPENMP
+    unsigned const threads = omp_get_max_threads();
+#else
+    unsigned const threads = 1;
+#endif
+    // One thread gains nothing from counting a w before it skips the w
+    if (threads < 2 || m_w_units[first] != UNKNOWN) {
+        return;
+    }
+    unsigned const last = std::min(m_last_w, first + threads - 1);
+    unsigned const N = m_board.N;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (unsigned w = first; w <= last; w++) {
+        if (m_w_units[w] == UNKNOWN) {
+            Board board(N);
+            uint64_t cnt = 0;
+            preplace_w(*m_pres, w, board, [&](Board const &, Symmetry::Direction) { cnt++; });
+            m_w_units[w] = cnt;
+        }
+    }
+}
+
+uint64_t preplacement_generator::units_of_step(unsigned &next_n) {
+    uint64_t cnt = 0;
+    next_n = preplace_wn(*m_pres, m_pos.w, m_pos.n, m_board, [&](Board const &, Symmetry::Direction) { cnt++; });
+    return cnt;
+}
+
+void preplacement_generator::fill_step() {
+    if (m_step_ready) {
+        return;
+    }
+    m_step.clear();
+    m_next_n = preplace_wn(*m_pres, m_pos.w, m_pos.n, m_board,
+                           [&](Board const &brd, Symmetry::Direction sym) { m_step.emplace_back(brd, sym); });
+    m_step_ready = true;
+}
+
+void preplacement_generator::next_step() {
+    m_pos.n = m_next_n;
+    m_pos.offset = 0;
+    m_step_ready = false;
+    if (m_pos.n >= m_pres->count() - m_pos.w) {
+        m_pos.w++;
+        m_pos.n = m_pos.w;
+    }
 }
@@ -4,7 +4,12 @@
 
 #include "symmetry.hpp"
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <span>
+#include <utility>
 #include <vector>
 
 /**
@@ -13,8 +18,133 @@
 using PreplaceCallback = void(queens::Board const &, queens::Symmetry::Direction);
 
 /**
- * @brief Run preplacer from q27 project
+ * Consecutive preplacements, in generation order.
+ */
+using PreplaceBatch = std::span<std::pair<queens::Board, queens::Symmetry::Direction> const>;
+
+/**
+ * Largest number of preplacements in one batch, each generator thread buffers at most one batch.
+ */
+static constexpr size_t PREPLACE_BATCH = 4096;
+
+/**
+ * @brief Upper bound of the memory preplace_batches() buffers, for all of its threads.
+ */
+size_t preplace_buffer_bytes();
+
+/**
+ * @brief Run preplacer from q27 project, generalized to coronal rings wider than 2, and hand out the preplacements
+ * in batches
  * @param N boardsize
- * @param callback Callback to further handle each computed preplacement
+ * @param callback Callback to further handle each batch of preplacements, the batch is only valid during the call.
+ * Batches hold at most PREPLACE_BATCH preplacements and are handed out one at a time.
+ * @param ring_width Number of outer columns and rows on each side to preplace, 2 <= ring_width < N / 2
  */
-void preplace(unsigned N, std::function<PreplaceCallback> callback);
+void preplace_batches(unsigned N, std::function<void(PreplaceBatch)> const &callback, unsigned ring_width = 2);
+
+/**
+ * @brief Run preplacer from q27 project, generalized to coronal rings wider than 2
+ *
+ * The callback is called directly for each preplacement, only the batches go through an indirect call.
+ * @param N boardsize
+ * @param callback Callable with the signature of PreplaceCallback to further handle each computed preplacement
+ * @param ring_width Number of outer columns and rows on each side to preplace, 2 <= ring_width < N / 2
+ */
+template <typename Callback>
+void preplace(unsigned N, Callback &&callback, unsigned ring_width = 2) {
+    preplace_batches(
+        N,
+        [&callback](PreplaceBatch batch) {
+            for (auto const &[brd, sym] : batch) {
+                callback(brd, sym);
+            }
+        },
+        ring_width);
+}
+
+class side_placements;
+
+/**
+ * @brief Pull based version of preplace(), gives the same preplacements in the same order.
+ *
+ * The preplacements are generated one step at a time, a step is one placement w of the first and n of the second
+ * side. The position can be saved with tell() and restored with seek() between any two preplacements, so a consumer
+ * can stop and resume or start at any unit without storing the units before it. seek() only generates the step of
+ * the position. Not thread safe, use one generator per thread.
+ */
+class preplacement_generator {
+    public:
+        /**
+         * Position of the next preplacement: the step (w, n) and the number of its preplacements already taken.
+         */
+        struct position {
+                unsigned w;
+                unsigned n;
+                size_t offset;
+        };
+
+        using unit = std::pair<queens::Board, queens::Symmetry::Direction>;
+
+    private:
+        static constexpr uint64_t UNKNOWN = ~uint64_t{0};
+
+        std::unique_ptr<side_placements const> m_pres;
+        unsigned m_last_w;
+        queens::Board m_board;
+        std::vector<uint64_t> m_w_units; // Preplacements of each placement w of the first side, UNKNOWN until known
+        position m_pos{0, 0, 0};
+        std::vector<unit> m_step; // Preplacements of the step at m_pos once m_step_ready
+        bool m_step_ready{false};
+        unsigned m_next_n{0}; // Second side of the step after m_pos once m_step_ready
+
+    public:
+        /**
+         * @param N boardsize
+         * @param ring_width Number of outer columns and rows on each side to preplace, 2 <= ring_width < N / 2
+         */
+        preplacement_generator(unsigned N, unsigned ring_width = 2);
+        ~preplacement_generator();
+        preplacement_generator(preplacement_generator const &) = delete;
+        preplacement_generator &operator=(preplacement_generator const &) = delete;
+
+        /**
+         * @brief Check if all preplacements were taken.
+         */
+        bool done() const { return m_pos.w > m_last_w; }
+
+        /**
+         * @brief Position of the next preplacement, to resume from with seek().
+         */
+        position tell() const { return m_pos; }
+
+        /**
+         * @brief Continue at a position returned by tell(), throws std::runtime_error if it is not a valid position.
+         */
+        void seek(position pos);
+
+        /**
+         * @brief Append the next preplacements to out.
+         * @param out Buffer for the preplacements
+         * @param max Largest number of preplacements to append
+         * @return Number of preplacements appended, less than max only when done
+         */
+        size_t pull(std::vector<unit> &out, size_t max);
+
+        /**
+         * @brief Skip preplacements without storing them, e.g. to start at a given unit index.
+         *
+         * Steps are skipped by their number of preplacements, counted without generating the units, only the step
+         * the skip ends in is generated. Once a skip passed a whole placement w of the first side, the next ones
+         * are counted ahead on all threads and skipped whole. Their counts are kept, so skipping them again after
+         * a seek() back costs nothing.
+         * @param count Number of preplacements to skip
+         * @return Number of preplacements skipped, less than count only when done
+         */
+        uint64_t skip(uint64_t count);
+
+    private:
+        void count_ahead(unsigned first);
+        uint64_t units_of_step(unsigned &next_n);
+        void fill_step();
+        void next_step();
+};
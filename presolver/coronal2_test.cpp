@@ -0,0 +1,108 @@
+#include "coronal2.hpp"
+#include "mini_board.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+/**
+ * Checks that preplacement_generator gives the preplace() order, however it is pulled, skipped and sought.
+ */
+
+using namespace queens;
+
+namespace {
+
+struct unit_key {
+        uint64_t bv;
+        uint64_t bh;
+        uint64_t bu;
+        uint64_t bd;
+        Symmetry::Direction sym;
+
+        bool operator==(unit_key const &) const = default;
+};
+
+unit_key key(Board const &brd, Symmetry::Direction sym, unsigned ring_width) {
+    mini_board const unit{brd, static_cast<uint8_t>(ring_width)};
+    return {unit.getBV(), unit.getBH(), unit.getBU(), unit.getBD(), sym};
+}
+
+std::vector<unit_key> pull_all(preplacement_generator &generator, unsigned ring_width, size_t batch) {
+    std::vector<unit_key> keys;
+    std::vector<preplacement_generator::unit> pulled;
+    while (generator.pull(pulled, batch) != 0) {
+        for (auto const &[brd, sym] : pulled) {
+            keys.push_back(key(brd, sym, ring_width));
+        }
+        pulled.clear();
+    }
+    return keys;
+}
+
+bool check(unsigned N, unsigned ring_width) {
+    std::vector<unit_key> expected;
+    {
+        // preplace() reports its progress, which would drown the result
+        std::ostringstream mute;
+        std::streambuf *const out = std::cout.rdbuf(mute.rdbuf());
+        preplace(N, [&](Board const &brd, Symmetry::Direction sym) { expected.push_back(key(brd, sym, ring_width)); },
+                 ring_width);
+        std::cout.rdbuf(out);
+    }
+
+    bool ok = true;
+    auto fail = [&](std::string const &what) {
+        std::cout << "N=" << N << ", ring width " << ring_width << ": " << what << std::endl;
+        ok = false;
+    };
+    auto tail = [&](size_t first) { return std::vector<unit_key>(expected.begin() + first, expected.end()); };
+
+    for (size_t batch : {size_t{1}, size_t{7}, size_t{4096}}) {
+        preplacement_generator generator{N, ring_width};
+        if (pull_all(generator, ring_width, batch) != expected) {
+            fail("pull(" + std::to_string(batch) + ") differs from preplace()");
+        }
+    }
+
+    for (size_t first : {size_t{0}, size_t{1}, expected.size() / 3, expected.size() / 2 + 1, expected.size() - 1,
+                         expected.size()}) {
+        preplacement_generator skipping{N, ring_width};
+        if (skipping.skip(first) != first) {
+            fail("skip(" + std::to_string(first) + ") ended early");
+        }
+        preplacement_generator::position const pos{skipping.tell()};
+
+        std::vector<unit_key> const rest{tail(first)};
+        if (pull_all(skipping, ring_width, 5) != rest) {
+            fail("units after skip(" + std::to_string(first) + ") differ from preplace()");
+        }
+        // seek(tell()) in a fresh generator and in one which went on
+        preplacement_generator seeking{N, ring_width};
+        seeking.seek(pos);
+        if (pull_all(seeking, ring_width, 3) != rest) {
+            fail("units after seek(tell()) at " + std::to_string(first) + " differ from preplace()");
+        }
+        skipping.seek(pos);
+        if (pull_all(skipping, ring_width, 64) != rest) {
+            fail("units after seeking back to " + std::to_string(first) + " differ from preplace()");
+        }
+    }
+
+    preplacement_generator past_end{N, ring_width};
+    if (past_end.skip(expected.size() + 10) != expected.size() || !past_end.done()) {
+        fail("skip() past the end");
+    }
+    return ok;
+}
+
+} // namespace
+
+int main() {
+    bool ok = true;
+    for (auto const &[N, ring_width] : {std::pair{9u, 2u}, {12u, 2u}, {12u, 3u}, {14u, 2u}}) {
+        ok &= check(N, ring_width);
+    }
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "cpu_solver_iterative.hpp"
+#include "instrument.hpp"
+#include "mini_board.hpp"
+#include "solver_engine.hpp"
+#include "subproblem.hpp"
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace queens {
+
+/**
+ * @brief Count the completions below one column with the number of columns left known at compile time.
+ *
+ * Every depth is its own instantiation, so there is no stack and no depth bookkeeping, the compiler sees the whole
+ * descent.
+ * @param bh, bu, bd Masks of the current column, bu and bd already moved to the current column
+ * @param shift Distances to the following free columns, see columnShifts()
+ * @param nodes Output, the search states visited are added to it, the same ones the recursive engine visits
+ */
+template <unsigned Levels>
+static uint64_t countLevels(uint64_t bh, uint64_t bu, uint64_t bd, uint8_t const *shift, uint64_t &nodes) {
+    static_assert(Levels >= 1);
+    uint64_t slots = ~(bh | bu | bd);
+    instrument::node(Levels, slots == 0);
+    if constexpr (Levels == 1) {
+        instrument::solutions(std::popcount(slots));
+        nodes += 1 + std::popcount(slots);
+        return std::popcount(slots);
+    } else if constexpr (Levels == 2) {
+        // Every free slot on the last column completes the board, so count them without descending
+        uint8_t const sh = shift[0];
+        uint64_t cnt = 0;
+        uint64_t const visited = 1 + std::popcount(slots);
+        for (; slots != 0; slots &= slots - 1) {
+            uint64_t const slot = slots & -slots;
+            uint64_t const leaves = std::popcount(~((bh | slot) | ((bu | slot) << sh) | ((bd | slot) >> sh)));
+            instrument::node(1, leaves == 0);
+            instrument::solutions(leaves);
+            cnt += leaves;
+        }
+        nodes += visited + cnt;
+        return cnt;
+    } else {
+        uint8_t const sh = shift[0];
+        uint64_t cnt = 0;
+        nodes++;
+        for (; slots != 0; slots &= slots - 1) {
+            uint64_t const slot = slots & -slots;
+            cnt += countLevels<Levels - 1>(bh | slot, (bu | slot) << sh, (bd | slot) >> sh, shift + 1, nodes);
+        }
+        return cnt;
+    }
+}
+
+using LevelKernel = uint64_t (*)(uint64_t bh, uint64_t bu, uint64_t bd, uint8_t const *shift, uint64_t &nodes);
+
+template <size_t... L> static constexpr std::array<LevelKernel, sizeof...(L)> levelKernels(std::index_sequence<L...>) {
+    return {(L == 0 ? nullptr : &countLevels<(L == 0 ? 1 : L)>)...};
+}
+
+/**
+ * @brief Kernels for every number of free columns, index 0 is unused.
+ */
+static constexpr auto LEVEL_KERNELS{levelKernels(std::make_index_sequence<ITERATIVE_MAX_DEPTH + 1>{})};
+
+/**
+ * @brief Engine specialized for board size N, the masks of the subproblem are constants and the descent is unrolled
+ * by countLevels().
+ *
+ * The distances between the free columns can't be constants of N: which inner columns the preplacement covers
+ * differs from unit to unit. They are computed once per unit, the kernel is picked by the number of free columns.
+ * @param n Size of the board, must be N
+ */
+template <unsigned N>
+static uint64_t countCompletionsFixed(mini_board const *units, size_t count, [[maybe_unused]] uint8_t n,
+                                      uint8_t ring_width, uint64_t *out) {
+    assert(n == N);
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < count; i++) {
+        instrument::unit_timer const timer;
+        subproblem const sub{subproblem::from<N>(units[i], ring_width)};
+        unsigned const levels = std::popcount(~sub.bh);
+        assert(levels <= N);
+        if (levels == 0) {
+            instrument::node(0, false);
+            nodes++;
+            out[i] = 1;
+            continue;
+        }
+
+        std::array<uint8_t, N> shift;
+        columnShifts(sub.bv, levels, shift.data());
+        out[i] = LEVEL_KERNELS[levels](sub.bh, sub.bu << shift[0], sub.bd >> shift[0], shift.data() + 1, nodes);
+    }
+    return nodes;
+}
+
+template <size_t... N> static constexpr std::array<SolverEngine, sizeof...(N)> fixedEngines(std::index_sequence<N...>) {
+    return {(N < 5 ? nullptr : &countCompletionsFixed<(N < 5 ? 5 : N)>)...};
+}
+
+/**
+ * @brief countCompletionsFixed() for every supported board size, indexed by board size.
+ */
+static constexpr auto FIXED_ENGINES{fixedEngines(std::make_index_sequence<33>{})};
+
+} // namespace queens
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "instrument.hpp"
+#include "mini_board.hpp"
+#include "subproblem.hpp"
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+
+namespace queens {
+
+/**
+ * @brief Maximum number of columns the iterative engine can place, boards are limited to 32 columns.
+ */
+static constexpr unsigned ITERATIVE_MAX_DEPTH = 32;
+
+/**
+ * @brief Compute the distance between the free columns the engine places queens in.
+ * @param bv Columns covered by the pre-placement
+ * @param levels Number of queens left to place
+ * @param shift Output, shift[d] is the distance from the column placed on depth d - 1 to the column placed on depth d
+ */
+static void columnShifts(uint32_t bv, unsigned levels, uint8_t *shift) {
+    uint64_t cols = bv;
+    unsigned last = 0;
+    unsigned col = 0;
+    for (unsigned d = 0; d < levels; d++) {
+        while ((cols & 1) != 0) { // Column is covered by pre-placement
+            cols >>= 1;
+            col++;
+        }
+        shift[d] = col - last;
+        last = col;
+        cols >>= 1;
+        col++;
+    }
+}
+
+/**
+ * @brief Same as the recursive countCompletions(), but runs an explicit stack in a single loop.
+ *
+ * The columns covered by the pre-placement are the same for every node on one depth, so the distance between
+ * two free columns is computed once upfront instead of skipping covered columns on every node.
+ * @param nodes Output, the search states visited are added to it, the same ones the recursive engine visits
+ */
+static uint64_t countCompletionsIterative(uint32_t bv, uint64_t bh, uint64_t bu, uint64_t bd, uint64_t &nodes) {
+    // Placement Complete if all bits (queens) are set
+    if (bh == std::numeric_limits<uint64_t>::max()) {
+        instrument::node(0, false);
+        nodes++;
+        return 1;
+    }
+
+    // Every missing row needs one queen in a free column
+    unsigned const levels = std::popcount(~bh);
+    assert(levels <= ITERATIVE_MAX_DEPTH);
+
+    std::array<uint8_t, ITERATIVE_MAX_DEPTH> shift;
+    columnShifts(bv, levels, shift.data());
+
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bh;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bu;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bd;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_slots;
+
+    if (levels == 1) {
+        uint64_t const cnt = std::popcount(~(bh | (bu << shift[0]) | (bd >> shift[0])));
+        instrument::node(1, cnt == 0);
+        instrument::solutions(cnt);
+        nodes += 1 + cnt;
+        return cnt;
+    }
+
+    unsigned const last = levels - 1;
+    uint64_t cnt = 0;
+    // States with queens left, the solutions are cnt
+    uint64_t visited = 1;
+
+    // The frame of the current depth lives in registers, the stack only holds the frames of the parents
+    unsigned d = 0;
+    bu <<= shift[0];
+    bd >>= shift[0];
+    uint64_t slots = ~(bh | bu | bd);
+    instrument::node(levels, slots == 0);
+
+    for (;;) {
+        if (d + 1 == last) {
+            // Every free slot on the last column completes the board, so count them without descending
+            uint8_t const sh = shift[last];
+            visited += std::popcount(slots);
+            for (; slots != 0; slots &= slots - 1) {
+                uint64_t const slot = slots & -slots;
+                uint64_t const leaves = std::popcount(~((bh | slot) | ((bu | slot) << sh) | ((bd | slot) >> sh)));
+                instrument::node(1, leaves == 0);
+                instrument::solutions(leaves);
+                cnt += leaves;
+            }
+        } else if (slots != 0) {
+            uint64_t const slot = slots & -slots;
+            s_bh[d] = bh;
+            s_bu[d] = bu;
+            s_bd[d] = bd;
+            s_slots[d] = slots ^ slot;
+
+            d++;
+            visited++;
+            bh |= slot;
+            bu = (bu | slot) << shift[d];
+            bd = (bd | slot) >> shift[d];
+            slots = ~(bh | bu | bd);
+            instrument::node(levels - d, slots == 0);
+            continue;
+        }
+
+        // Column exhausted, go back to the previous one
+        if (d == 0) {
+            break;
+        }
+        d--;
+        bh = s_bh[d];
+        bu = s_bu[d];
+        bd = s_bd[d];
+        slots = s_slots[d];
+    }
+
+    nodes += visited + cnt;
+    return cnt;
+}
+
+static uint64_t countCompletionsIterative(queens::mini_board const &brd, uint8_t n, uint8_t ring_width,
+                                          uint64_t &nodes) {
+    subproblem const sub{subproblem::from(brd, n, ring_width)};
+    return countCompletionsIterative(sub.bv, sub.bh, sub.bu, sub.bd, nodes);
+}
+
+}; // namespace queens
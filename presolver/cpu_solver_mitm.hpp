@@ -0,0 +1,164 @@
+#pragma once
+
+#include "instrument.hpp"
+#include "mini_board.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../bithacks.hpp"
+
+namespace queens {
+
+/**
+ * @brief Queens placed on one half of the free columns, the masks only hold the new queens.
+ */
+struct mitm_half {
+        uint32_t bh;
+        uint64_t bu;
+        uint64_t bd;
+};
+
+/**
+ * @brief Call leaf for every placement of one queen on each of the columns cols[0..count) which conflicts neither
+ * with the queens already on the board nor with each other.
+ *
+ * The masks are in board coordinates like in mini_board: the queen (x, y) covers bit y of bh, N - 1 - x + y of bu
+ * and x + y of bd.
+ * @param nodes Output, the placements visited are added to it, one per call
+ */
+template <typename Leaf>
+static void placeHalf(uint8_t const *cols, unsigned count, uint8_t n, uint32_t board_mask, uint32_t bh, uint64_t bu,
+                      uint64_t bd, uint64_t &nodes, Leaf &&leaf) {
+    nodes++;
+    if (count == 0) {
+        leaf(bh, bu, bd);
+        return;
+    }
+    unsigned const x = cols[0];
+    // Bit y of the shifted diagonals is the diagonal through (x, y)
+    uint32_t slots = board_mask & ~(bh | static_cast<uint32_t>(bu >> (n - 1 - x)) | static_cast<uint32_t>(bd >> x));
+    for (; slots != 0; slots &= slots - 1) {
+        unsigned const y = __builtin_ctz(slots);
+        placeHalf(cols + 1, count - 1, n, board_mask, bh | (uint32_t{1} << y), bu | (uint64_t{1} << (n - 1 - x + y)),
+                  bd | (uint64_t{1} << (x + y)), nodes, leaf);
+    }
+}
+
+/**
+ * @brief Open addressing hash table from the rows of the right half placements to their range in the sorted list.
+ */
+struct mitm_index {
+        struct slot {
+                uint32_t bh; // 0 for an empty slot, every right half places at least one queen
+                uint32_t first;
+                uint32_t last;
+        };
+
+        std::vector<slot> slots;
+        unsigned shift;
+
+        /**
+         * @brief Index a list of right half placements sorted by bh.
+         */
+        void build(std::vector<mitm_half> const &right) {
+            size_t size = 16;
+            while (size < 2 * right.size()) {
+                size *= 2;
+            }
+            shift = 64 - __builtin_ctzll(size);
+            slots.assign(size, slot{0, 0, 0});
+            for (size_t first = 0; first < right.size();) {
+                size_t last = first + 1;
+                while (last < right.size() && right[last].bh == right[first].bh) {
+                    last++;
+                }
+                size_t i = position(right[first].bh);
+                while (slots[i].bh != 0) {
+                    i = (i + 1) & (slots.size() - 1);
+                }
+                slots[i] = {right[first].bh, static_cast<uint32_t>(first), static_cast<uint32_t>(last)};
+                first = last;
+            }
+        }
+
+        /**
+         * @brief Range of the placements on exactly the rows bh, empty if there are none.
+         */
+        slot find(uint32_t bh) const {
+            for (size_t i = position(bh);; i = (i + 1) & (slots.size() - 1)) {
+                if (slots[i].bh == bh || slots[i].bh == 0) {
+                    return slots[i];
+                }
+            }
+        }
+
+    private:
+        size_t position(uint32_t bh) const { return (bh * UINT64_C(0x9e3779b97f4a7c15)) >> shift; }
+};
+
+/**
+ * @brief Meet in the middle: count the completions of a work unit by joining placements of the two halves of its
+ * free columns.
+ *
+ * All placements of the right half are listed, grouped by their rows and indexed by them in a hash table. Each
+ * placement of the left half is then joined with the right placements on exactly the remaining rows, which pass if
+ * they share no diagonal with it. Diagonals can't be part of the key, the halves have to cover disjoint diagonals
+ * instead of equal ones, so every join scans the group of its rows.
+ * @param right Scratch buffer, reused between work units
+ * @param index Scratch hash table, reused between work units
+ * @param nodes Output, the placements of both halves and the solutions are added to it
+ */
+static uint64_t countCompletionsMitm(mini_board const &brd, uint8_t n, std::vector<mitm_half> &right,
+                                     mitm_index &index, uint64_t &nodes) {
+    uint32_t const board_mask = bithacks::bits<uint32_t>(0, n - 1);
+    uint32_t const bh = static_cast<uint32_t>(brd.getBH());
+    uint32_t const free_rows = board_mask & ~bh;
+
+    std::array<uint8_t, 32> cols;
+    unsigned count = 0;
+    for (uint32_t c = board_mask & ~static_cast<uint32_t>(brd.getBV()); c != 0; c &= c - 1) {
+        cols[count++] = __builtin_ctz(c);
+    }
+    unsigned const left = count / 2;
+
+    right.clear();
+    placeHalf(cols.data() + left, count - left, n, board_mask, bh, brd.getBU(), brd.getBD(), nodes,
+              [&](uint32_t h, uint64_t u, uint64_t d) {
+                  right.push_back({h ^ bh, u ^ brd.getBU(), d ^ brd.getBD()});
+              });
+    std::sort(right.begin(), right.end(), [](mitm_half const &a, mitm_half const &b) { return a.bh < b.bh; });
+    index.build(right);
+
+    uint64_t cnt = 0;
+    placeHalf(cols.data(), left, n, board_mask, bh, brd.getBU(), brd.getBD(), nodes,
+              [&](uint32_t h, uint64_t u, uint64_t d) {
+                  uint64_t const new_u = u ^ brd.getBU();
+                  uint64_t const new_d = d ^ brd.getBD();
+                  mitm_index::slot const group = index.find(free_rows & ~h);
+                  for (uint32_t i = group.first; i < group.last; i++) {
+                      cnt += ((right[i].bu & new_u) | (right[i].bd & new_d)) == 0;
+                  }
+              });
+    nodes += cnt;
+    return cnt;
+}
+
+/**
+ * @brief SolverEngine of the meet in the middle search, shares the scratch buffers across the batch.
+ */
+static uint64_t countCompletionsMitmBatch(mini_board const *units, size_t count, uint8_t n, uint8_t,
+                                          uint64_t *out) {
+    std::vector<mitm_half> right;
+    mitm_index index;
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < count; i++) {
+        instrument::unit_timer const timer;
+        out[i] = countCompletionsMitm(units[i], n, right, index, nodes);
+    }
+    return nodes;
+}
+
+} // namespace queens
@@ -1,14 +1,22 @@
 #pragma once
 
 #include "board.hpp"
+#include "instrument.hpp"
 #include "mini_board.hpp"
+#include "subproblem.hpp"
+#include <bit>
 #include <cstdint>
 #include <numeric>
 
 namespace queens {
-static uint64_t countCompletions(uint32_t bv, uint64_t bh, uint64_t bu, uint64_t bd) {
+/**
+ * @param nodes Output, the search states visited are added to it, one per call
+ */
+static uint64_t countCompletions(uint32_t bv, uint64_t bh, uint64_t bu, uint64_t bd, uint64_t &nodes) {
+    nodes++;
     // Placement Complete if all bits (queens) are set
     if (bh == std::numeric_limits<uint64_t>::max()) {
+        instrument::node(0, false);
         return 1;
     }
 
@@ -22,29 +30,24 @@ static uint64_t countCompletions(uint32_t bv, uint64_t bh, uint64_t bu, uint64_t
 
     // Column needs to be placed
     uint64_t cnt = 0;
+    instrument::node(std::popcount(~bh), (bh | bu | bd) == std::numeric_limits<uint64_t>::max());
     for (uint64_t slots = ~(bh | bu | bd); slots != 0;) {
         uint64_t const slot = slots & -slots;
-        cnt += countCompletions(bv, bh | slot, (bu | slot) << 1, (bd | slot) >> 1);
+        cnt += countCompletions(bv, bh | slot, (bu | slot) << 1, (bd | slot) >> 1, nodes);
         slots ^= slot;
     }
 
     return cnt;
 }
 
-static uint64_t countCompletions(queens::mini_board const &brd, uint8_t n) {
-    unsigned const N = n;
-
-    // Compute a bitmask where all bits which are a valid queen placement are '1'
-    const uint64_t board_mask{bithacks::bits<uint32_t>(0, N - 1)};
-
-    // TODO: find out why the shift needs to be (N - 7)
-    const uint64_t bh_shifted = brd.getBH() << (N - 7);
-    const uint64_t board_mask_shifted = board_mask << (N - 7);
-    // Need to set all bits that are outside the board range to '1'
-    const uint64_t bh_new = bh_shifted | ~board_mask_shifted;
-    return countCompletions(brd.getBV() >> 2, bh_new, brd.getBU() >> 4, (brd.getBD() >> 4) << (N - 5));
+static uint64_t countCompletions(queens::mini_board const &brd, uint8_t n, uint8_t ring_width, uint64_t &nodes) {
+    subproblem const sub{subproblem::from(brd, n, ring_width)};
+    return countCompletions(sub.bv, sub.bh, sub.bu, sub.bd, nodes);
 }
 
-static uint64_t countCompletions(Board const &brd) { return countCompletions(queens::mini_board(brd), brd.N); }
+static uint64_t countCompletions(Board const &brd) {
+    uint64_t nodes = 0;
+    return countCompletions(queens::mini_board(brd), brd.N, 2, nodes);
+}
 
 }; // namespace queens
@@ -0,0 +1,233 @@
+#pragma once
+
+#include "cpu_solver_iterative.hpp"
+#include "mini_board.hpp"
+#include "subproblem.hpp"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace queens {
+
+/**
+ * @brief Number of work units the lane engine runs in lockstep, one per 64 bit SIMD lane.
+ */
+#if defined(__AVX512F__)
+static constexpr unsigned SIMD_LANES = 8;
+#elif defined(__AVX2__)
+static constexpr unsigned SIMD_LANES = 4;
+#else
+static constexpr unsigned SIMD_LANES = 1;
+#endif
+
+namespace simd {
+template <unsigned Lanes> struct vector {
+        // GCC drops vector_size on dependent alias templates, a typedef in a class template keeps it
+        typedef uint64_t type __attribute__((vector_size(Lanes * sizeof(uint64_t))));
+};
+template <unsigned Lanes> using u64v = typename vector<Lanes>::type;
+
+/**
+ * @brief Count the bits set in each lane, there is no popcount for vector types before AVX-512.
+ */
+template <unsigned Lanes> static inline u64v<Lanes> popcount(u64v<Lanes> x) {
+    x = x - ((x >> 1) & 0x5555555555555555);
+    x = (x & 0x3333333333333333) + ((x >> 2) & 0x3333333333333333);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0f;
+    x += x >> 8;
+    x += x >> 16;
+    x += x >> 32;
+    return x & 0x7f;
+}
+
+/**
+ * @brief Turn the result of a lane wise comparison into an all ones / all zeros mask of the same type.
+ */
+template <unsigned Lanes, typename M> static inline u64v<Lanes> mask(M m) { return reinterpret_cast<u64v<Lanes>>(m); }
+
+/**
+ * @brief Store each lane to base[idx * Lanes + lane], the layout of a per depth stack with one entry per lane.
+ */
+template <unsigned Lanes> static inline void scatter(uint64_t *base, u64v<Lanes> idx, u64v<Lanes> val) {
+#if defined(__AVX512F__)
+    if constexpr (Lanes == 8) {
+        __m512i const offs = reinterpret_cast<__m512i>(idx * Lanes + u64v<Lanes>{0, 1, 2, 3, 4, 5, 6, 7});
+        _mm512_i64scatter_epi64(base, offs, reinterpret_cast<__m512i>(val), sizeof(uint64_t));
+        return;
+    }
+#endif
+    for (unsigned l = 0; l < Lanes; l++) {
+        base[idx[l] * Lanes + l] = val[l];
+    }
+}
+
+/**
+ * @brief Load each lane from base[idx * Lanes + lane], the counterpart of scatter().
+ */
+template <unsigned Lanes> static inline u64v<Lanes> gather(uint64_t const *base, u64v<Lanes> idx) {
+#if defined(__AVX512F__)
+    if constexpr (Lanes == 8) {
+        __m512i const offs = reinterpret_cast<__m512i>(idx * Lanes + u64v<Lanes>{0, 1, 2, 3, 4, 5, 6, 7});
+        return reinterpret_cast<u64v<Lanes>>(_mm512_i64gather_epi64(offs, base, sizeof(uint64_t)));
+    }
+#endif
+#if defined(__AVX2__)
+    if constexpr (Lanes == 4) {
+        __m256i const offs = reinterpret_cast<__m256i>(idx * Lanes + u64v<Lanes>{0, 1, 2, 3});
+        return reinterpret_cast<u64v<Lanes>>(
+            _mm256_i64gather_epi64(reinterpret_cast<long long const *>(base), offs, sizeof(uint64_t)));
+    }
+#endif
+    u64v<Lanes> res;
+    for (unsigned l = 0; l < Lanes; l++) {
+        res[l] = base[idx[l] * Lanes + l];
+    }
+    return res;
+}
+} // namespace simd
+
+/**
+ * @brief Run the explicit-stack engine for several work units at once, each one in its own SIMD lane.
+ *
+ * Each lane does one step per iteration, either counting the leaves below one slot on the second to last column,
+ * descending into one slot or going back up. When the unit in a lane is done, the lane is refilled with the next
+ * unit, so lanes only idle at the very end of the batch.
+ *
+ * @param units Work units to solve
+ * @param count Number of work units
+ * @param n Size of the board
+ * @param ring_width Width of the coronal ring of the work units
+ * @param out Output, out[i] is the number of completions of units[i]
+ * @return Search states visited, the same ones the iterative engine visits
+ */
+template <unsigned Lanes = SIMD_LANES>
+static uint64_t countCompletionsBatch(mini_board const *units, size_t count, uint8_t n, uint8_t ring_width,
+                                      uint64_t *out) {
+    uint64_t nodes = 0;
+    if constexpr (Lanes == 1) {
+        // Scalar fallback
+        for (size_t i = 0; i < count; i++) {
+            out[i] = countCompletionsIterative(units[i], n, ring_width, nodes);
+        }
+    } else {
+        using vec = simd::u64v<Lanes>;
+
+        std::array<std::array<uint8_t, ITERATIVE_MAX_DEPTH>, Lanes> shift{};
+        std::array<size_t, Lanes> unit;
+        std::array<std::array<uint64_t, Lanes>, ITERATIVE_MAX_DEPTH> s_bh;
+        std::array<std::array<uint64_t, Lanes>, ITERATIVE_MAX_DEPTH> s_bu;
+        std::array<std::array<uint64_t, Lanes>, ITERATIVE_MAX_DEPTH> s_bd;
+        std::array<std::array<uint64_t, Lanes>, ITERATIVE_MAX_DEPTH> s_slots;
+
+        // Frame of the current depth per lane
+        vec bh{};
+        vec bu{};
+        vec bd{};
+        vec slots{};
+        vec d{};
+        // Depth of the second to last column per lane, idle lanes never reach it
+        vec penult{};
+        vec cnt{};
+        // Steps which placed a queen per lane, each one visits a state
+        vec steps{};
+
+        size_t next = 0;
+        unsigned active = 0;
+
+        // Load the next unit that needs a search into a lane, returns false if there is none left
+        auto refill = [&](unsigned l) {
+            while (next < count) {
+                size_t const i = next++;
+                subproblem const sub{subproblem::from(units[i], n, ring_width)};
+                unsigned const levels = std::popcount(~sub.bh);
+                assert(levels <= ITERATIVE_MAX_DEPTH);
+                if (levels < 2) {
+                    // Trivial units are handled by the scalar engine
+                    out[i] = countCompletionsIterative(sub.bv, sub.bh, sub.bu, sub.bd, nodes);
+                    continue;
+                }
+                columnShifts(sub.bv, levels, shift[l].data());
+                unit[l] = i;
+                bh[l] = sub.bh;
+                bu[l] = sub.bu << shift[l][0];
+                bd[l] = sub.bd >> shift[l][0];
+                slots[l] = ~(bh[l] | bu[l] | bd[l]);
+                d[l] = 0;
+                penult[l] = levels - 2;
+                cnt[l] = 0;
+                steps[l] = 0;
+                return true;
+            }
+            slots[l] = 0;
+            d[l] = 0;
+            penult[l] = ITERATIVE_MAX_DEPTH;
+            return false;
+        };
+
+        for (unsigned l = 0; l < Lanes; l++) {
+            active += refill(l);
+        }
+
+        while (active != 0) {
+            vec sh{};
+            for (unsigned l = 0; l < Lanes; l++) {
+                sh[l] = shift[l][d[l] + 1];
+            }
+
+            vec const has = simd::mask<Lanes>(slots != 0);
+            vec const slot = slots & -slots;
+            vec const rest = slots ^ slot;
+            vec const nbh = bh | slot;
+            vec const nbu = (bu | slot) << sh;
+            vec const nbd = (bd | slot) >> sh;
+            vec const nslots = ~(nbh | nbu | nbd);
+            vec const last = simd::mask<Lanes>(d == penult);
+
+            // Every free slot on the last column completes the board, so count them without descending
+            cnt += simd::popcount<Lanes>(nslots) & (has & last);
+            steps -= has;
+
+            // Spill the current frame of every lane, only the one of descending lanes becomes live. The entry at
+            // the current depth is unused otherwise, so no lane needs to be masked out.
+            simd::scatter<Lanes>(s_bh.data()->data(), d, bh);
+            simd::scatter<Lanes>(s_bu.data()->data(), d, bu);
+            simd::scatter<Lanes>(s_bd.data()->data(), d, bd);
+            simd::scatter<Lanes>(s_slots.data()->data(), d, rest);
+
+            vec const descend = has & ~last;
+            bh = descend ? nbh : bh;
+            bu = descend ? nbu : bu;
+            bd = descend ? nbd : bd;
+            slots = descend ? nslots : rest;
+            d -= descend;
+
+            // Column exhausted, go back to the previous one
+            vec const up = ~has & simd::mask<Lanes>(d != 0);
+            d += up;
+            bh = up ? simd::gather<Lanes>(s_bh.data()->data(), d) : bh;
+            bu = up ? simd::gather<Lanes>(s_bu.data()->data(), d) : bu;
+            bd = up ? simd::gather<Lanes>(s_bd.data()->data(), d) : bd;
+            slots = up ? simd::gather<Lanes>(s_slots.data()->data(), d) : slots;
+
+            // Unit done, idle lanes have no slots at depth 0 either but are not running
+            vec const done = ~has & ~up & simd::mask<Lanes>(penult != ITERATIVE_MAX_DEPTH);
+            for (unsigned l = 0; l < Lanes; l++) {
+                if (done[l]) {
+                    out[unit[l]] = cnt[l];
+                    // The root, the states of the steps and the solutions
+                    nodes += 1 + steps[l] + cnt[l];
+                    active -= !refill(l);
+                }
+            }
+        }
+    }
+    return nodes;
+}
+
+}; // namespace queens
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "cpu_solver_iterative.hpp"
+#include "instrument.hpp"
+#include "split_queue.hpp"
+#include "subproblem.hpp"
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+namespace queens {
+
+/**
+ * @brief Same as countCompletionsIterative(), but hands parts of the search to idle threads when it runs long.
+ *
+ * Every budget search states the engine checks if threads are waiting for work. If so, it publishes the untried
+ * slots of the shallowest column which still has some as subproblems of their own and continues without them, so the
+ * count of this call plus the counts of the published subproblems is the count of sub.
+ * @param sub Subproblem to solve, bv, bu and bd aligned to its first column as in countCompletions()
+ * @param budget Search states between two checks, at least 1
+ * @param sink Receives the subproblems split off
+ * @param nodes Output, the search states visited are added to it, the same ones the iterative engine visits
+ */
+static uint64_t countCompletionsSplit(subproblem const &sub, uint64_t budget, split_sink &sink, uint64_t &nodes) {
+    uint64_t bh = sub.bh;
+    uint64_t bu = sub.bu;
+    uint64_t bd = sub.bd;
+
+    // Placement Complete if all bits (queens) are set
+    if (bh == std::numeric_limits<uint64_t>::max()) {
+        instrument::node(0, false);
+        nodes++;
+        return 1;
+    }
+
+    unsigned const levels = std::popcount(~bh);
+    assert(levels <= ITERATIVE_MAX_DEPTH && budget > 0);
+
+    std::array<uint8_t, ITERATIVE_MAX_DEPTH> shift;
+    columnShifts(sub.bv, levels, shift.data());
+
+    if (levels == 1) {
+        uint64_t const cnt = std::popcount(~(bh | (bu << shift[0]) | (bd >> shift[0])));
+        instrument::node(1, cnt == 0);
+        instrument::solutions(cnt);
+        nodes += 1 + cnt;
+        return cnt;
+    }
+
+    // Board column of each depth, relative to the first column of sub
+    std::array<uint8_t, ITERATIVE_MAX_DEPTH> column;
+    column[0] = shift[0];
+    for (unsigned d = 1; d < levels; d++) {
+        column[d] = column[d - 1] + shift[d];
+    }
+
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bh;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bu;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bd;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_slots;
+
+    unsigned const last = levels - 1;
+    uint64_t cnt = 0;
+    // States with queens left, the solutions are cnt
+    uint64_t visited = 1;
+    uint64_t left = budget;
+    // Depths above this one have no untried slots left
+    unsigned shallowest = 0;
+
+    unsigned d = 0;
+    bu <<= shift[0];
+    bd >>= shift[0];
+    uint64_t slots = ~(bh | bu | bd);
+    instrument::node(levels, slots == 0);
+
+    for (;;) {
+        if (d + 1 == last) {
+            // Every free slot on the last column completes the board, so count them without descending
+            uint8_t const sh = shift[last];
+            visited += std::popcount(slots);
+            for (; slots != 0; slots &= slots - 1) {
+                uint64_t const slot = slots & -slots;
+                uint64_t const leaves = std::popcount(~((bh | slot) | ((bu | slot) << sh) | ((bd | slot) >> sh)));
+                instrument::node(1, leaves == 0);
+                instrument::solutions(leaves);
+                cnt += leaves;
+            }
+        } else if (slots != 0) {
+            uint64_t const slot = slots & -slots;
+            s_bh[d] = bh;
+            s_bu[d] = bu;
+            s_bd[d] = bd;
+            s_slots[d] = slots ^ slot;
+
+            d++;
+            visited++;
+            bh |= slot;
+            bu = (bu | slot) << shift[d];
+            bd = (bd | slot) >> shift[d];
+            slots = ~(bh | bu | bd);
+            instrument::node(levels - d, slots == 0);
+
+            if (--left == 0) {
+                left = budget;
+                if (sink.hungry()) {
+                    while (shallowest < d && s_slots[shallowest] == 0) {
+                        shallowest++;
+                    }
+                    if (shallowest < d) {
+                        // Each untried slot becomes a subproblem starting on the column after it
+                        unsigned const next = column[shallowest] + 1;
+                        uint32_t const bv = next < 32 ? sub.bv >> next : 0;
+                        for (uint64_t rest = s_slots[shallowest]; rest != 0; rest &= rest - 1) {
+                            uint64_t const split = rest & -rest;
+                            sink.publish({bv, s_bh[shallowest] | split, (s_bu[shallowest] | split) << 1,
+                                          (s_bd[shallowest] | split) >> 1});
+                        }
+                        s_slots[shallowest] = 0;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // Column exhausted, go back to the previous one
+        if (d == 0) {
+            break;
+        }
+        d--;
+        bh = s_bh[d];
+        bu = s_bu[d];
+        bd = s_bd[d];
+        slots = s_slots[d];
+    }
+
+    nodes += visited + cnt;
+    return cnt;
+}
+
+} // namespace queens
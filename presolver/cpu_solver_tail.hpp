@@ -0,0 +1,240 @@
+#pragma once
+
+#include "cpu_solver_iterative.hpp"
+#include "mini_board.hpp"
+#include "subproblem.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace queens {
+
+/**
+ * @brief Number of queens the tail engine counts with its lookup tables instead of searching.
+ */
+static constexpr unsigned TAIL_QUEENS = 3;
+
+/**
+ * @brief Upper bound for the size of the tables of one tail width, they are used on every tail so they have to stay
+ * in the L2 cache next to the search state.
+ */
+static constexpr size_t TAIL_TABLE_LIMIT = 256 * 1024;
+
+/**
+ * @brief Lookup tables to count the ways of placing the last K queens.
+ *
+ * The last K queens go to the K free rows r_0 < ... < r_{K-1} and the K free columns c_0 < ... < c_{K-1}. Every way
+ * of placing them is a permutation p which puts the queen of row r_i into column c_{p(i)}, the tables hold sets of
+ * these permutations as bitmasks. A permutation is a solution if every queen is on a free cell and no two of the new
+ * queens share a diagonal:
+ *   allowed[A] are the permutations which only use free cells, bit j * K + i of A is set if row r_i is free on
+ *     column c_j as seen from the queens already placed.
+ *   conflicts[rows][cols] are the permutations which put the queens of a pair of rows onto a pair of columns, they
+ *     are ruled out if the distance of the rows equals the distance of the columns.
+ */
+template <unsigned K> struct tail_tables {
+        static constexpr unsigned PAIRS = K * (K - 1) / 2;
+
+        std::array<uint32_t, size_t{1} << (K * K)> allowed{};
+        std::array<std::array<uint32_t, PAIRS>, PAIRS> conflicts{};
+
+        constexpr tail_tables() {
+            std::array<uint8_t, K> perm{};
+            std::iota(perm.begin(), perm.end(), 0);
+            unsigned idx = 0;
+            do {
+                uint32_t const bit = uint32_t{1} << idx++;
+                for (size_t a = 0; a < allowed.size(); a++) {
+                    bool free = true;
+                    for (unsigned i = 0; i < K; i++) {
+                        free &= ((a >> (perm[i] * K + i)) & 1) != 0;
+                    }
+                    allowed[a] |= free ? bit : 0;
+                }
+                unsigned rows = 0;
+                for (unsigned i = 0; i < K; i++) {
+                    for (unsigned j = i + 1; j < K; j++, rows++) {
+                        conflicts[rows][pair_index(std::min(perm[i], perm[j]), std::max(perm[i], perm[j]))] |= bit;
+                    }
+                }
+            } while (std::next_permutation(perm.begin(), perm.end()));
+        }
+
+        /**
+         * @brief Index of the pair i < j in the order the pairs are enumerated, (0, 1), (0, 2), ..., (1, 2), ...
+         */
+        static constexpr unsigned pair_index(unsigned i, unsigned j) { return i * (2 * K - i - 1) / 2 + j - i - 1; }
+};
+
+template <unsigned K> static constexpr tail_tables<K> TAIL_TABLES{};
+
+static_assert(sizeof(tail_tables<TAIL_QUEENS>) <= TAIL_TABLE_LIMIT);
+
+/**
+ * @brief Gather the bits of value selected by mask into the low bits, like the BMI2 instruction PEXT.
+ */
+static inline uint64_t extractBits(uint64_t value, uint64_t mask) {
+#if defined(__BMI2__)
+    return _pext_u64(value, mask);
+#else
+    uint64_t out = 0;
+    for (unsigned i = 0; mask != 0; mask &= mask - 1, i++) {
+        out |= ((value >> std::countr_zero(mask)) & 1) << i;
+    }
+    return out;
+#endif
+}
+
+/**
+ * @brief Permutations of the tail ruled out by the distance of two rows, for the columns of one work unit.
+ *
+ * The free columns are the same for all tails of a work unit, so the conflicts of each pair of rows are gathered by
+ * the distance of the rows once per work unit.
+ */
+template <unsigned K> struct tail_conflicts {
+        // Rows and columns are bits of 64 bit masks
+        static constexpr unsigned MAX_DISTANCE = 64;
+
+        std::array<std::array<uint32_t, MAX_DISTANCE>, tail_tables<K>::PAIRS> by_distance{};
+
+        explicit tail_conflicts(std::array<uint8_t, K> const &offset) {
+            tail_tables<K> const &tables = TAIL_TABLES<K>;
+            for (unsigned rows = 0; rows < tail_tables<K>::PAIRS; rows++) {
+                unsigned cols = 0;
+                for (unsigned c = 0; c < K; c++) {
+                    for (unsigned d = c + 1; d < K; d++, cols++) {
+                        assert(static_cast<unsigned>(offset[d] - offset[c]) < MAX_DISTANCE);
+                        by_distance[rows][offset[d] - offset[c]] |= tables.conflicts[rows][cols];
+                    }
+                }
+            }
+        }
+};
+
+/**
+ * @brief Count the completions of a state with exactly K queens left by table lookup, without branches on the state.
+ * @param bh Rows covered so far
+ * @param bu Up diagonals aligned to the first of the K free columns
+ * @param bd Down diagonals aligned to the first of the K free columns
+ * @param offset offset[j] is the distance from the first free column to free column j, offset[0] is 0
+ * @param conflicts Conflicts of the new queens for the same offsets
+ */
+template <unsigned K>
+static uint64_t countTail(uint64_t bh, uint64_t bu, uint64_t bd, std::array<uint8_t, K> const &offset,
+                          tail_conflicts<K> const &conflicts) {
+    uint64_t const rows = ~bh;
+
+    size_t free_cells = 0;
+    for (unsigned j = 0; j < K; j++) {
+        uint64_t const free = ~(bh | (bu << offset[j]) | (bd >> offset[j]));
+        free_cells |= extractBits(free, rows) << (j * K);
+    }
+
+    std::array<unsigned, K> row;
+    uint64_t r = rows;
+    for (unsigned i = 0; i < K; i++, r &= r - 1) {
+        row[i] = std::countr_zero(r);
+    }
+
+    uint32_t ruled_out = 0;
+    unsigned rows_pair = 0;
+    for (unsigned a = 0; a < K; a++) {
+        for (unsigned b = a + 1; b < K; b++, rows_pair++) {
+            ruled_out |= conflicts.by_distance[rows_pair][row[b] - row[a]];
+        }
+    }
+    return std::popcount(TAIL_TABLES<K>.allowed[free_cells] & ~ruled_out);
+}
+
+/**
+ * @brief Same as countCompletionsIterative(), but the last TAIL_QUEENS queens are counted by countTail().
+ *
+ * Most states of the search are on its deepest levels, they are replaced by one lookup per state with TAIL_QUEENS
+ * queens left. Not instrumented, the states below the tail are never visited.
+ * @param nodes Output, the search states visited down to the tails and the solutions are added to it
+ */
+static uint64_t countCompletionsTail(uint32_t bv, uint64_t bh, uint64_t bu, uint64_t bd, uint64_t &nodes) {
+    constexpr unsigned K = TAIL_QUEENS;
+    unsigned const levels = std::popcount(~bh);
+    if (levels <= K) {
+        return countCompletionsIterative(bv, bh, bu, bd, nodes);
+    }
+    assert(levels <= ITERATIVE_MAX_DEPTH);
+
+    std::array<uint8_t, ITERATIVE_MAX_DEPTH> shift;
+    columnShifts(bv, levels, shift.data());
+
+    // Depth of the first column of the tail and the distances of the tail columns from it
+    unsigned const tail = levels - K;
+    std::array<uint8_t, K> offset{};
+    for (unsigned j = 1; j < K; j++) {
+        offset[j] = offset[j - 1] + shift[tail + j];
+    }
+    tail_conflicts<K> const conflicts{offset};
+
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bh;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bu;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_bd;
+    std::array<uint64_t, ITERATIVE_MAX_DEPTH> s_slots;
+
+    uint64_t cnt = 0;
+    // States with queens left, the solutions are cnt
+    uint64_t visited = 1;
+    unsigned d = 0;
+    bu <<= shift[0];
+    bd >>= shift[0];
+    uint64_t slots = ~(bh | bu | bd);
+
+    for (;;) {
+        if (d + 1 == tail) {
+            // Every free slot on the column before the tail starts one tail
+            uint8_t const sh = shift[tail];
+            visited += std::popcount(slots);
+            for (; slots != 0; slots &= slots - 1) {
+                uint64_t const slot = slots & -slots;
+                cnt += countTail<K>(bh | slot, (bu | slot) << sh, (bd | slot) >> sh, offset, conflicts);
+            }
+        } else if (slots != 0) {
+            uint64_t const slot = slots & -slots;
+            s_bh[d] = bh;
+            s_bu[d] = bu;
+            s_bd[d] = bd;
+            s_slots[d] = slots ^ slot;
+
+            d++;
+            visited++;
+            bh |= slot;
+            bu = (bu | slot) << shift[d];
+            bd = (bd | slot) >> shift[d];
+            slots = ~(bh | bu | bd);
+            continue;
+        }
+
+        // Column exhausted, go back to the previous one
+        if (d == 0) {
+            break;
+        }
+        d--;
+        bh = s_bh[d];
+        bu = s_bu[d];
+        bd = s_bd[d];
+        slots = s_slots[d];
+    }
+
+    nodes += visited + cnt;
+    return cnt;
+}
+
+static uint64_t countCompletionsTail(queens::mini_board const &brd, uint8_t n, uint8_t ring_width, uint64_t &nodes) {
+    subproblem const sub{subproblem::from(brd, n, ring_width)};
+    return countCompletionsTail(sub.bv, sub.bh, sub.bu, sub.bd, nodes);
+}
+
+}; // namespace queens
@@ -0,0 +1,69 @@
+#include "dedup.hpp"
+
+#include "subproblem.hpp"
+#include <bit>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace queens;
+
+static bool operator==(subproblem const &a, subproblem const &b) {
+    return a.bv == b.bv && a.bh == b.bh && a.bu == b.bu && a.bd == b.bd;
+}
+
+static uint64_t hash(subproblem const &sub) {
+    // Multiply-xorshift mixing of all fields, the low bits of the raw masks are almost always the same
+    uint64_t h = sub.bv;
+    for (uint64_t v : {sub.bh, sub.bu, sub.bd}) {
+        h = (h ^ v) * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+/**
+ * @brief Decode a unit to the mini_board its subproblem is computed from.
+ */
+static mini_board const &board(mini_board const &unit, uint8_t, uint8_t) { return unit; }
+static mini_board board(packed_unit unit, uint8_t n, uint8_t ring_width) { return unit.unpack(n, ring_width); }
+
+template <typename Unit>
+static unique_units<Unit> deduplicate_units(std::span<Unit const> units, uint8_t n, uint8_t ring_width) {
+    if (units.size() >= std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Too many work units to deduplicate: " + std::to_string(units.size()));
+    }
+
+    static constexpr uint32_t EMPTY = std::numeric_limits<uint32_t>::max();
+    // Open addressing with linear probing, slots hold indices into result.units. Keeping the table at most half full
+    // keeps the probe sequences short, the subproblems are recomputed on a probe instead of being stored.
+    std::vector<uint32_t> table(std::bit_ceil(2 * units.size() + 1), EMPTY);
+    size_t const mask = table.size() - 1;
+
+    unique_units<Unit> result;
+    for (Unit const &unit : units) {
+        subproblem const sub{subproblem::from(board(unit, n, ring_width), n, ring_width)};
+        for (size_t slot = hash(sub) & mask;; slot = (slot + 1) & mask) {
+            uint32_t const idx = table[slot];
+            if (idx == EMPTY) {
+                table[slot] = result.units.size();
+                result.units.push_back(unit);
+                result.occurrences.push_back(1);
+                break;
+            }
+            if (subproblem::from(board(result.units[idx], n, ring_width), n, ring_width) == sub) {
+                result.occurrences[idx]++;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+unique_units<mini_board> queens::deduplicate(std::span<mini_board const> units, uint8_t n, uint8_t ring_width) {
+    return deduplicate_units(units, n, ring_width);
+}
+
+unique_units<packed_unit> queens::deduplicate(std::span<packed_unit const> units, uint8_t n, uint8_t ring_width) {
+    return deduplicate_units(units, n, ring_width);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "mini_board.hpp"
+#include "packed_unit.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief Work units of one symmetry class with the units that reduce to the same subproblem merged.
+ * @tparam Unit mini_board or packed_unit, the form the units came in
+ */
+template <typename Unit>
+struct unique_units {
+        std::vector<Unit> units;           // First unit of each distinct subproblem, in the order of the input
+        std::vector<uint32_t> occurrences; // Number of input units which reduce to the subproblem of units[i]
+};
+
+/**
+ * @brief Merge work units whose subproblems are identical, so each distinct subproblem is solved once.
+ *
+ * The completions of units[i] have to be multiplied by occurrences[i]. Only units of the same symmetry class are
+ * merged, units of different classes never reduce to the same subproblem.
+ * @param units Work units of one symmetry class
+ * @param n Size of the board
+ * @param ring_width Width of the coronal ring of the work units
+ */
+unique_units<mini_board> deduplicate(std::span<mini_board const> units, uint8_t n, uint8_t ring_width);
+unique_units<packed_unit> deduplicate(std::span<packed_unit const> units, uint8_t n, uint8_t ring_width);
+
+} // namespace queens
@@ -0,0 +1,67 @@
+#include "engines.hpp"
+
+#include <array>
+
+using namespace queens;
+
+// One declaration per compilation of engines_isa.cpp, CMakeLists.txt defines QUEENS_ISA_<level> for each of them
+#define DECLARE_ISA(level) \
+    namespace queens::level { \
+    SolverEngine select_engine(std::string_view name, uint8_t n); \
+    uint64_t solve_split(subproblem const &sub, uint64_t budget, split_sink &sink, uint64_t &nodes); \
+    }
+
+#ifdef QUEENS_ISA_x86_64_v4
+DECLARE_ISA(x86_64_v4)
+#endif
+#ifdef QUEENS_ISA_x86_64_v3
+DECLARE_ISA(x86_64_v3)
+#endif
+#ifdef QUEENS_ISA_x86_64_v2
+DECLARE_ISA(x86_64_v2)
+#endif
+DECLARE_ISA(generic)
+
+#if defined(__x86_64__) || defined(__i386__)
+// Features added by each level, the CPUID checks of the compiler runtime include the OS support for the registers
+static bool supports_v2() {
+    return __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("ssse3");
+}
+
+static bool supports_v3() {
+    return supports_v2() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2") &&
+           __builtin_cpu_supports("fma");
+}
+
+static bool supports_v4() {
+    return supports_v3() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") &&
+           __builtin_cpu_supports("avx512vl");
+}
+#endif
+
+static bool supports_all() { return true; }
+
+static constexpr std::array VARIANTS{
+#ifdef QUEENS_ISA_x86_64_v4
+    isa_variant{"x86-64-v4", supports_v4, x86_64_v4::select_engine, x86_64_v4::solve_split},
+#endif
+#ifdef QUEENS_ISA_x86_64_v3
+    isa_variant{"x86-64-v3", supports_v3, x86_64_v3::select_engine, x86_64_v3::solve_split},
+#endif
+#ifdef QUEENS_ISA_x86_64_v2
+    isa_variant{"x86-64-v2", supports_v2, x86_64_v2::select_engine, x86_64_v2::solve_split},
+#endif
+    isa_variant{"generic", supports_all, generic::select_engine, generic::solve_split},
+};
+
+std::span<isa_variant const> queens::isa_variants() { return VARIANTS; }
+
+isa_variant const &queens::best_isa_variant() {
+    for (isa_variant const &variant : VARIANTS) {
+        if (variant.supported()) {
+            return variant;
+        }
+    }
+    return VARIANTS.back();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "solver_engine.hpp"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace queens {
+
+/**
+ * @brief Entry of the engine registry.
+ */
+struct engine_info {
+        std::string_view name;
+        std::string_view description;
+        // Not faster than the others anywhere yet, -e auto leaves it out
+        bool experimental{false};
+};
+
+/**
+ * @brief Registry of all solver engines. Every feature level builds one engine per entry, in the same order, see
+ * engines_isa.cpp.
+ */
+static constexpr std::array ENGINES{
+    engine_info{"recursive", "Depth first search, one call per search state"},
+    engine_info{"iterative", "Depth first search with an explicit stack"},
+    engine_info{"simd", "Iterative search of several work units at once in vector registers"},
+    engine_info{"fixed", "Search unrolled for each number of free columns, with the masks of each board size"},
+    engine_info{"tail", "Iterative search which looks up the completions of the last queens in tables"},
+    engine_info{"mitm", "Experimental, meet in the middle, joins the placements of both halves of the free columns",
+                true},
+};
+
+/**
+ * @brief Name which selects the engine by timing all but the experimental ones, see autotune_engine().
+ */
+static constexpr std::string_view AUTO_ENGINE{"auto"};
+
+/**
+ * @brief Check if name is in the engine registry, AUTO_ENGINE is not.
+ */
+static constexpr bool known_engine(std::string_view name) {
+    for (engine_info const &engine : ENGINES) {
+        if (engine.name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Engine to use for a board size, chosen once before solving. Returns nullptr for unknown engine names.
+ */
+using EngineSelector = SolverEngine (*)(std::string_view name, uint8_t n);
+
+/**
+ * @brief The solver engines compiled for one x86-64 feature level.
+ */
+struct isa_variant {
+        char const *name;
+        bool (*supported)();
+        EngineSelector select;
+        SplitEngine split;
+};
+
+/**
+ * @brief All variants in this binary, best first. The last one runs on every CPU of the architecture.
+ */
+std::span<isa_variant const> isa_variants();
+
+/**
+ * @brief Best variant the CPU supports, checked with CPUID.
+ */
+isa_variant const &best_isa_variant();
+
+} // namespace queens
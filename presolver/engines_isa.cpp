@@ -0,0 +1,65 @@
+// Compiled once per x86-64 feature level with QUEENS_ISA set to the name of the level, see CMakeLists.txt. The
+// engines are static templates, so each compilation gets its own copy built for its instruction set. Inline functions
+// and template instances with external linkage are emitted by every copy as well. Each copy is partially linked with
+// only select_engine and solve_split left global, so the linker can't pick the ones built for another level.
+#include "cpu_solver_fixed.hpp"
+#include "cpu_solver_iterative.hpp"
+#include "cpu_solver_mitm.hpp"
+#include "cpu_solver_recursive.hpp"
+#include "cpu_solver_simd.hpp"
+#include "cpu_solver_split.hpp"
+#include "cpu_solver_tail.hpp"
+#include "engines.hpp"
+#include "solver_engine.hpp"
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#ifndef QUEENS_ISA
+#error "QUEENS_ISA must name the feature level this file is compiled for"
+#endif
+
+namespace queens::QUEENS_ISA {
+
+/**
+ * @brief Engine of this feature level for one entry of the registry.
+ */
+struct engine_factory {
+        std::string_view name;
+        SolverEngine (*make)(uint8_t n); // nullptr if the engine can't solve boardsize n
+};
+
+static constexpr std::array<engine_factory, ENGINES.size()> FACTORIES{
+    engine_factory{"recursive", [](uint8_t) -> SolverEngine { return solve_each<countCompletions>; }},
+    engine_factory{"iterative", [](uint8_t) -> SolverEngine { return solve_each<countCompletionsIterative>; }},
+    engine_factory{"simd", [](uint8_t) -> SolverEngine { return countCompletionsBatch<>; }},
+    engine_factory{"fixed",
+                   [](uint8_t n) -> SolverEngine { return n < FIXED_ENGINES.size() ? FIXED_ENGINES[n] : nullptr; }},
+    engine_factory{"tail", [](uint8_t) -> SolverEngine { return solve_each<countCompletionsTail>; }},
+    engine_factory{"mitm", [](uint8_t) -> SolverEngine { return countCompletionsMitmBatch; }},
+};
+
+static constexpr bool matches_registry() {
+    for (size_t i = 0; i < ENGINES.size(); i++) {
+        if (FACTORIES[i].name != ENGINES[i].name) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(matches_registry(), "FACTORIES must list the engines in the order of ENGINES");
+
+SolverEngine select_engine(std::string_view name, uint8_t n) {
+    for (engine_factory const &factory : FACTORIES) {
+        if (factory.name == name) {
+            return factory.make(n);
+        }
+    }
+    return nullptr;
+}
+
+uint64_t solve_split(subproblem const &sub, uint64_t budget, split_sink &sink, uint64_t &nodes) {
+    return countCompletionsSplit(sub, budget, sink, nodes);
+}
+
+} // namespace queens::QUEENS_ISA
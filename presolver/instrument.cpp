@@ -0,0 +1,72 @@
+#include "instrument.hpp"
+
+#ifdef QUEENS_INSTRUMENT
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace queens::instrument;
+
+thread_local constinit counters *queens::instrument::t_counters{nullptr};
+
+static std::mutex s_lock;
+static std::vector<std::unique_ptr<counters>> s_threads;
+
+counters *queens::instrument::register_thread() {
+    std::lock_guard<std::mutex> guard{s_lock};
+    s_threads.push_back(std::make_unique<counters>());
+    return s_threads.back().get();
+}
+
+void queens::instrument::report(std::ostream &out, std::chrono::steady_clock::duration wall) {
+    std::lock_guard<std::mutex> guard{s_lock};
+    counters total{};
+    for (auto const &c : s_threads) {
+        for (unsigned i = 0; i <= MAX_LEVELS; i++) {
+            total.nodes[i] += c->nodes[i];
+            total.dead_ends[i] += c->dead_ends[i];
+        }
+        for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+            total.unit_latency[i] += c->unit_latency[i];
+        }
+    }
+
+    out << "Instrumentation:" << std::endl;
+    out << "Queens left       nodes   dead ends" << std::endl;
+    for (unsigned i = MAX_LEVELS + 1; i-- > 0;) {
+        if (total.nodes[i] != 0) {
+            out << std::setw(11) << i << std::setw(12) << total.nodes[i] << std::setw(12) << total.dead_ends[i]
+                << std::endl;
+        }
+    }
+
+    out << "Work unit latency" << std::endl;
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        if (total.unit_latency[i] != 0) {
+            out << " [" << std::setw(12) << (uint64_t{1} << i) << " ns, " << std::setw(12) << (uint64_t{1} << (i + 1))
+                << " ns) = " << total.unit_latency[i] << std::endl;
+        }
+    }
+
+    double const wall_s = std::chrono::duration<double>(wall).count();
+    out << "Thread load" << std::endl;
+    for (size_t t = 0; t < s_threads.size(); t++) {
+        double const busy_s = std::chrono::duration<double>(s_threads[t]->busy).count();
+        out << " [" << t << "] busy " << busy_s << " s, idle " << (wall_s > busy_s ? wall_s - busy_s : 0.0) << " s"
+            << std::endl;
+    }
+}
+
+uint64_t queens::instrument::visited() {
+    std::lock_guard<std::mutex> guard{s_lock};
+    uint64_t total = 0;
+    for (auto const &c : s_threads) {
+        for (uint64_t &nodes : c->nodes) {
+            total += std::atomic_ref<uint64_t>{nodes}.load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+#endif
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * Instrumentation of the solver hot path, compiled in by defining QUEENS_INSTRUMENT (cmake -DQUEENS_INSTRUMENT=ON).
+ * Without it all hooks are empty inline functions and the engines compile to the same code as without them.
+ *
+ * Search states are counted by the number of queens left to place, so the root of a work unit is on the highest
+ * level and the solutions are on level 0. Dead ends are states with queens left but no free slot on their column.
+ * The recursive, iterative and fixed engines count the same states, the simd, tail and mitm engines are not
+ * instrumented.
+ *
+ * Each thread only writes its own counters, the node counts are written with relaxed atomic stores so visited() may
+ * read them while the threads are solving.
+ */
+namespace queens::instrument {
+
+static constexpr unsigned MAX_LEVELS = 32;
+// Work unit latencies are counted in buckets of [2^i, 2^(i+1)) nanoseconds
+static constexpr unsigned LATENCY_BUCKETS = 40;
+
+/**
+ * @brief Counters of one thread, aligned so threads never write to the same cache line.
+ */
+struct alignas(64) counters {
+        std::array<uint64_t, MAX_LEVELS + 1> nodes{};
+        std::array<uint64_t, MAX_LEVELS + 1> dead_ends{};
+        std::array<uint64_t, LATENCY_BUCKETS> unit_latency{};
+        std::chrono::steady_clock::duration busy{};
+};
+
+#ifdef QUEENS_INSTRUMENT
+static constexpr bool ENABLED = true;
+
+/**
+ * @brief Create and register the counters of the calling thread, they are kept until the end of the program.
+ */
+counters *register_thread();
+
+// Defined in the core library, so the engine copies, whose symbols are localized, share it with the rest of the
+// program. constinit spares the engines the call of a thread_local wrapper.
+extern thread_local constinit counters *t_counters;
+
+inline counters &local() {
+    if (t_counters == nullptr) {
+        t_counters = register_thread();
+    }
+    return *t_counters;
+}
+
+/**
+ * @brief Add to a counter only the calling thread writes, without a locked instruction.
+ */
+inline void add(uint64_t &counter, uint64_t count) {
+    std::atomic_ref<uint64_t>{counter}.store(counter + count, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Count a search state with left queens still to place.
+ */
+inline void node(unsigned left, bool dead_end) {
+    counters &c = local();
+    add(c.nodes[left], 1);
+    c.dead_ends[left] += dead_end;
+}
+
+/**
+ * @brief Count solutions the engine found without visiting them.
+ */
+inline void solutions(uint64_t count) { add(local().nodes[0], count); }
+
+/**
+ * @brief Add the time from construction to destruction to the latency histogram of work units.
+ */
+class unit_timer {
+        std::chrono::steady_clock::time_point const m_start{std::chrono::steady_clock::now()};
+
+    public:
+        ~unit_timer() {
+            auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                                 m_start)
+                                .count();
+            unsigned const bucket = ns > 0 ? 63 - __builtin_clzll(ns) : 0;
+            local().unit_latency[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+        }
+};
+
+/**
+ * @brief Add the time from construction to destruction to the busy time of the thread.
+ */
+class busy_timer {
+        std::chrono::steady_clock::time_point const m_start{std::chrono::steady_clock::now()};
+
+    public:
+        ~busy_timer() { local().busy += std::chrono::steady_clock::now() - m_start; }
+};
+
+/**
+ * @brief Write the summed counters and the load of every thread.
+ * @param wall Time the threads had for solving, the rest of it is reported as idle
+ */
+void report(std::ostream &out, std::chrono::steady_clock::duration wall);
+
+/**
+ * @brief Search states counted by all threads so far, including the solutions.
+ */
+uint64_t visited();
+#else
+static constexpr bool ENABLED = false;
+
+inline void node(unsigned, bool) {}
+inline void solutions(uint64_t) {}
+// Constructors of their own, so the compiler doesn't take the timers for unused variables
+struct unit_timer {
+        unit_timer() {}
+};
+struct busy_timer {
+        busy_timer() {}
+};
+inline void report(std::ostream &, std::chrono::steady_clock::duration) {}
+inline uint64_t visited() { return 0; }
+#endif
+
+} // namespace queens::instrument
@@ -0,0 +1,182 @@
+#include "journal.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace queens;
+
+static constexpr char const *MAGIC = "m-queens3-journal 1";
+
+static std::string journal_header(uint8_t boardsize, uint8_t ring_width, std::string const &layout, size_t chunk,
+                                  std::array<size_t, ALL_SYMMETRIES.size()> units) {
+    std::ostringstream header;
+    header << "N " << unsigned{boardsize} << " ring " << unsigned{ring_width};
+    // Journals of the full list in generation order have no layout, so they stay compatible with older journals
+    if (!layout.empty()) {
+        header << ' ' << layout;
+    }
+    header << " chunk " << chunk << " units";
+    for (size_t count : units) {
+        header << ' ' << count;
+    }
+    return header.str();
+}
+
+solve_journal::solve_journal(std::string const &path, uint8_t boardsize, uint8_t ring_width,
+                             std::string const &layout, size_t chunk,
+                             std::array<size_t, ALL_SYMMETRIES.size()> const &units, bool resume,
+                             std::chrono::steady_clock::duration interval)
+    : m_path{path}, m_fd{-1}, m_length{0}, m_interval{interval}, m_last_flush{std::chrono::steady_clock::now()} {
+    for (size_t i = 0; i < units.size(); i++) {
+        m_done[i].resize((units[i] + chunk - 1) / chunk);
+    }
+
+    std::string const header{journal_header(boardsize, ring_width, layout, chunk, units)};
+    size_t valid = 0;
+    if (resume) {
+        valid = restore(header);
+        m_fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+    } else {
+        m_fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_EXCL, 0644);
+    }
+    if (m_fd < 0) {
+        throw std::runtime_error("Can't open journal " + path + ": " + std::strerror(errno));
+    }
+    m_length = valid;
+    if (resume && ::ftruncate(m_fd, valid) != 0) {
+        ::close(m_fd);
+        throw std::runtime_error("Can't truncate journal " + path + ": " + std::strerror(errno));
+    }
+    if (!resume) {
+        write(std::string{MAGIC} + '\n' + header + '\n');
+    }
+}
+
+solve_journal::~solve_journal() {
+    try {
+        flush();
+    } catch (std::runtime_error const &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    ::close(m_fd);
+}
+
+size_t solve_journal::restore(std::string const &header) {
+    std::ifstream in{m_path, std::ios::binary};
+    if (!in) {
+        throw std::runtime_error("Can't open journal " + m_path + ": " + std::strerror(errno));
+    }
+    std::string const content{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+
+    // A record cut short by a crash has no newline, it is dropped and its chunks are solved again
+    size_t const valid = content.rfind('\n') + 1;
+    std::istringstream lines{content.substr(0, valid)};
+
+    std::string line;
+    if (!std::getline(lines, line) || line != MAGIC) {
+        throw std::runtime_error("Journal " + m_path + " is not a journal");
+    }
+    if (!std::getline(lines, line) || line != header) {
+        throw std::runtime_error("Journal " + m_path + " was written for other work units: " + line);
+    }
+
+    while (std::getline(lines, line)) {
+        std::istringstream record{line};
+        char type;
+        unsigned sym;
+        size_t first;
+        size_t count;
+        uint64_t completions;
+        if (!(record >> type >> sym >> first >> count >> completions) || type != 'R' || sym >= m_done.size() ||
+            first > m_done[sym].size() || count > m_done[sym].size() - first) {
+            throw std::runtime_error("Journal " + m_path + " has an invalid record: " + line);
+        }
+        for (size_t c = first; c < first + count; c++) {
+            if (m_done[sym][c]) {
+                throw std::runtime_error("Journal " + m_path + " records chunk " + std::to_string(c) + " twice");
+            }
+            m_done[sym][c] = true;
+        }
+        m_restored[sym] += completions;
+        m_restored_chunks += count;
+    }
+    return valid;
+}
+
+void solve_journal::record(Symmetry sym, size_t chunk, uint64_t completions) {
+    std::lock_guard<std::mutex> guard{m_lock};
+    m_pending[sym].emplace_back(chunk, completions);
+    if (std::chrono::steady_clock::now() - m_last_flush >= m_interval) {
+        try {
+            flush_locked();
+        } catch (std::runtime_error const &e) {
+            // Keep solving, the chunks stay pending and are written with the next flush
+            std::cerr << e.what() << std::endl;
+        }
+    }
+}
+
+void solve_journal::flush() {
+    std::lock_guard<std::mutex> guard{m_lock};
+    flush_locked();
+}
+
+void solve_journal::flush_locked() {
+    m_last_flush = std::chrono::steady_clock::now();
+
+    std::ostringstream records;
+    for (unsigned sym = 0; sym < m_pending.size(); sym++) {
+        auto &pending = m_pending[sym];
+        std::sort(pending.begin(), pending.end());
+        // Merge consecutive chunks into one range
+        for (size_t i = 0; i < pending.size();) {
+            size_t const first = pending[i].first;
+            uint64_t completions = 0;
+            size_t count = 0;
+            for (; i < pending.size() && pending[i].first == first + count; i++, count++) {
+                completions += pending[i].second;
+            }
+            records << "R " << sym << ' ' << first << ' ' << count << ' ' << completions << '\n';
+        }
+    }
+
+    write(records.str());
+    for (auto &pending : m_pending) {
+        pending.clear();
+    }
+}
+
+void solve_journal::write(std::string const &data) {
+    auto fail = [&](char const *what) {
+        std::string const error{std::strerror(errno)};
+        // Drop partially written records, they are written again with the next flush
+        if (::ftruncate(m_fd, m_length) != 0) {
+            std::cerr << "Can't truncate journal " << m_path << ": " << std::strerror(errno) << std::endl;
+        }
+        throw std::runtime_error("Can't " + std::string{what} + " journal " + m_path + ": " + error);
+    };
+
+    for (size_t written = 0; written < data.size();) {
+        ssize_t const res = ::write(m_fd, data.data() + written, data.size() - written);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("write");
+        }
+        written += res;
+    }
+    if (::fsync(m_fd) != 0) {
+        fail("sync");
+    }
+    m_length += data.size();
+}
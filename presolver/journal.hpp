@@ -0,0 +1,94 @@
+#pragma once
+
+#include "symmetry.hpp"
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief Append-only journal of solved chunks, so an interrupted solve can be resumed.
+ *
+ * Chunks are the SOLVE_CHUNK sized ranges of the canonical work unit list of one symmetry class. Solved chunks are
+ * collected in memory and written as ranges of consecutive chunks with their summed counts once the interval has
+ * passed since the last write and on destruction, each write is followed by an fsync.
+ *
+ * File format, one record per line:
+ *   m-queens3-journal 1
+ *   N <boardsize> ring <ring width> [<layout>] chunk <units per chunk> units <ROTATE> <POINT> <NONE>
+ *   R <symmetry> <first chunk> <number of chunks> <completions>
+ * Symmetry classes are given by their index, see Symmetry::Direction. The layout tells which units were selected and
+ * how they were ordered, it is left out for the full list in generation order.
+ */
+class solve_journal {
+    public:
+        using counts_t = std::array<uint64_t, ALL_SYMMETRIES.size()>;
+
+    private:
+        std::string const m_path;
+        int m_fd;
+        size_t m_length; // Length of the journal up to the last complete write
+        std::chrono::steady_clock::duration const m_interval;
+        std::chrono::steady_clock::time_point m_last_flush;
+        std::array<std::vector<bool>, ALL_SYMMETRIES.size()> m_done;
+        counts_t m_restored{};
+        size_t m_restored_chunks{0};
+
+        std::mutex m_lock;
+        std::array<std::vector<std::pair<size_t, uint64_t>>, ALL_SYMMETRIES.size()> m_pending;
+
+    public:
+        /**
+         * @brief Create a new journal or continue an existing one, throws std::runtime_error on failure.
+         * @param path Path of the journal
+         * @param boardsize Size of the board
+         * @param ring_width Width of the coronal ring of the work units
+         * @param layout Selection and order of the work units, the chunks of different layouts hold different units.
+         * Empty for the full list in generation order.
+         * @param chunk Number of work units per chunk
+         * @param units Number of work units per symmetry class
+         * @param resume Continue an existing journal, it must match boardsize, ring_width, layout, chunk and units.
+         * Without resume the journal must not exist yet.
+         * @param interval Minimum time between two writes
+         */
+        solve_journal(std::string const &path, uint8_t boardsize, uint8_t ring_width, std::string const &layout,
+                      size_t chunk, std::array<size_t, ALL_SYMMETRIES.size()> const &units, bool resume,
+                      std::chrono::steady_clock::duration interval);
+        ~solve_journal();
+        solve_journal(solve_journal const &) = delete;
+        solve_journal &operator=(solve_journal const &) = delete;
+
+        /**
+         * @brief Check if a chunk was already solved by a previous run.
+         */
+        bool done(Symmetry sym, size_t chunk) const { return m_done[sym][chunk]; }
+
+        /**
+         * @brief Completions per symmetry class of the chunks solved by previous runs, not weighted.
+         */
+        counts_t const &restored() const { return m_restored; }
+        size_t restored_chunks() const { return m_restored_chunks; }
+
+        /**
+         * @brief Record a solved chunk, can be called concurrently.
+         */
+        void record(Symmetry sym, size_t chunk, uint64_t completions);
+
+        /**
+         * @brief Write and sync all recorded chunks, throws std::runtime_error on failure.
+         */
+        void flush();
+
+    private:
+        size_t restore(std::string const &header);
+        void write(std::string const &data);
+        void flush_locked();
+};
+
+} // namespace queens
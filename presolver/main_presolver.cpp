@@ -0,0 +1,3 @@
+#include "commands.hpp"
+
+int main(int argc, char *argv[]) { return queens::presolver_main("m-queens3-presolver", argc, argv); }
@@ -18,13 +18,18 @@ class mini_board {
         uint32_t m_bh;
 
     public:
-        mini_board(Board brd)
+        // Uninitialized, only for preallocated storage that is assigned before use
+        mini_board() = default;
+        mini_board(Board const &brd, [[maybe_unused]] uint8_t ring_width = 2)
             : m_bu{brd.getBU()}, m_bd{brd.getBD()}, m_bv{static_cast<uint32_t>(brd.getBV())},
               m_bh{static_cast<uint32_t>(brd.getBH())} {
             assert(valid_counts(brd.placed));
-            assert(valid_coronal(2, brd.N));
+            assert(valid_coronal(ring_width, brd.N));
         }
 
+        // From the masks of another mini_board, e.g. received over the network, they are not validated
+        mini_board(uint32_t bv, uint32_t bh, uint64_t bu, uint64_t bd) : m_bu{bu}, m_bd{bd}, m_bv{bv}, m_bh{bh} {}
+
         uint64_t getBV() const { return m_bv; }
         uint64_t getBH() const { return m_bh; }
         uint64_t getBU() const { return m_bu; }
@@ -0,0 +1,159 @@
+#include "numa.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace queens;
+
+/**
+ * @brief Parse a CPU number, false unless text is a decimal number below CPU_SETSIZE.
+ */
+static bool parse_cpu(std::string const &text, unsigned &cpu) {
+    if (text.empty() || text.size() > 6 || !std::all_of(text.begin(), text.end(), [](char c) {
+            return c >= '0' && c <= '9';
+        })) {
+        return false;
+    }
+    cpu = std::stoul(text);
+    return cpu < CPU_SETSIZE;
+}
+
+std::vector<unsigned> queens::parse_cpu_list(std::string const &text) {
+    std::vector<unsigned> cpus;
+    std::istringstream in{text};
+    for (std::string range; std::getline(in, range, ',');) {
+        // sysfs ends the list with a newline, nodes without CPUs have an empty list
+        range.erase(std::remove_if(range.begin(), range.end(), [](unsigned char c) { return std::isspace(c); }),
+                    range.end());
+        if (range.empty()) {
+            continue;
+        }
+        size_t const dash = range.find('-');
+        unsigned first;
+        unsigned last;
+        if (!parse_cpu(range.substr(0, dash), first) ||
+            !parse_cpu(dash == std::string::npos ? range : range.substr(dash + 1), last) || last < first) {
+            throw std::runtime_error("Invalid CPU list " + text);
+        }
+        for (unsigned cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::vector<unsigned> queens::thread_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        throw std::runtime_error("Can't read the CPU affinity of the thread");
+    }
+    std::vector<unsigned> cpus;
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void queens::pin_thread(std::vector<unsigned> const &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        throw std::runtime_error("Can't pin the thread to " + std::to_string(cpus.size()) + " CPUs");
+    }
+}
+
+numa_topology numa_topology::discover(std::string const &root) {
+    std::vector<unsigned> const allowed{thread_cpus()};
+    numa_topology topology;
+
+    std::error_code error;
+    for (std::filesystem::directory_entry const &entry : std::filesystem::directory_iterator{root, error}) {
+        std::string const name{entry.path().filename().string()};
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            continue;
+        }
+        std::ifstream in{entry.path() / "cpulist"};
+        if (!in) {
+            continue;
+        }
+        std::string const list{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+        numa_node node{static_cast<unsigned>(std::stoul(name.substr(4))), {}};
+        for (unsigned cpu : parse_cpu_list(list)) {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                node.cpus.push_back(cpu);
+            }
+        }
+        if (!node.cpus.empty()) {
+            topology.nodes.push_back(std::move(node));
+        }
+    }
+
+    if (topology.nodes.empty()) {
+        topology.nodes.push_back({0, allowed});
+    }
+    std::sort(topology.nodes.begin(), topology.nodes.end(),
+              [](numa_node const &a, numa_node const &b) { return a.id < b.id; });
+    return topology;
+}
+
+std::vector<worker_placement> queens::place_workers(numa_topology const &topology, unsigned workers) {
+    size_t total = 0;
+    for (numa_node const &node : topology.nodes) {
+        total += node.cpus.size();
+    }
+
+    std::vector<worker_placement> placement;
+    size_t before = 0; // CPUs of the nodes before the current one
+    for (unsigned n = 0; n < topology.nodes.size(); n++) {
+        std::vector<unsigned> const &cpus = topology.nodes[n].cpus;
+        size_t const first = (workers * before + total / 2) / total;
+        before += cpus.size();
+        size_t const last = (workers * before + total / 2) / total;
+        for (size_t w = first; w < last; w++) {
+            placement.push_back({n, cpus[(w - first) % cpus.size()]});
+        }
+    }
+    return placement;
+}
+
+void queens::for_each_node(numa_topology const &topology, std::function<void(unsigned node)> const &fn) {
+    std::exception_ptr error;
+    std::mutex error_lock;
+    std::vector<std::thread> threads;
+    for (unsigned n = 0; n < topology.nodes.size(); n++) {
+        threads.emplace_back([&, n] {
+            try {
+                pin_thread(topology.nodes[n].cpus);
+                fn(n);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard{error_lock};
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        });
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
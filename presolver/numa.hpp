@@ -0,0 +1,71 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief NUMA node with the CPUs of it this process may run on.
+ */
+struct numa_node {
+        unsigned id;
+        std::vector<unsigned> cpus;
+};
+
+/**
+ * @brief NUMA nodes of the machine as seen by this process.
+ */
+struct numa_topology {
+        std::vector<numa_node> nodes;
+
+        /**
+         * @brief Read the nodes from sysfs, <root>/node<id>/cpulist.
+         *
+         * Only CPUs in the affinity mask of the process are kept and nodes without any of them, like memory only
+         * nodes, are left out. Without NUMA support in sysfs all allowed CPUs form node 0. Throws std::runtime_error
+         * if a cpulist is malformed or the affinity mask can't be read.
+         */
+        static numa_topology discover(std::string const &root = "/sys/devices/system/node");
+};
+
+/**
+ * @brief Parse a CPU list like "0-3,8,10-11" as found in sysfs, throws std::runtime_error if it is malformed.
+ */
+std::vector<unsigned> parse_cpu_list(std::string const &text);
+
+/**
+ * @brief Node and CPU a worker thread is pinned to.
+ */
+struct worker_placement {
+        unsigned node; // Index into numa_topology::nodes
+        unsigned cpu;
+};
+
+/**
+ * @brief Spread workers over the nodes in proportion to their CPUs.
+ *
+ * The workers of a node are numbered consecutively, starting with node 0, and take the CPUs of their node in turn.
+ */
+std::vector<worker_placement> place_workers(numa_topology const &topology, unsigned workers);
+
+/**
+ * @brief Restrict the calling thread to the CPUs, throws std::runtime_error on failure.
+ */
+void pin_thread(std::vector<unsigned> const &cpus);
+
+/**
+ * @brief CPUs the calling thread may run on, throws std::runtime_error on failure.
+ */
+std::vector<unsigned> thread_cpus();
+
+/**
+ * @brief Run fn(node) on one thread per node, pinned to the CPUs of the node, so memory fn touches first is
+ * allocated on it.
+ *
+ * The first exception thrown by fn is rethrown after all threads stopped.
+ */
+void for_each_node(numa_topology const &topology, std::function<void(unsigned node)> const &fn);
+
+} // namespace queens
@@ -0,0 +1,184 @@
+#include "chunk_solver.hpp"
+#include "coronal2.hpp"
+#include "numa.hpp"
+#include "results.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Checks the NUMA topology discovery on a fake sysfs tree, the placement of the workers and a solve spread over two
+ * nodes.
+ */
+
+using namespace queens;
+
+namespace {
+
+bool ok = true;
+
+void fail(std::string const &what) {
+    std::cout << what << std::endl;
+    ok = false;
+}
+
+std::string join(std::vector<unsigned> const &cpus) {
+    std::string text;
+    for (unsigned cpu : cpus) {
+        if (!text.empty()) {
+            text += ',';
+        }
+        text += std::to_string(cpu);
+    }
+    return text;
+}
+
+void check_parse() {
+    struct parse_case {
+            std::string text;
+            std::vector<unsigned> cpus;
+    };
+    for (parse_case const &c : {parse_case{"0-3,8\n", {0, 1, 2, 3, 8}}, parse_case{"", {}}, parse_case{"\n", {}},
+                                parse_case{"5", {5}}, parse_case{"2-2,1,1", {1, 2}}}) {
+        if (parse_cpu_list(c.text) != c.cpus) {
+            fail("parse_cpu_list(\"" + c.text + "\") isn't " + join(c.cpus));
+        }
+    }
+    for (std::string const text : {"a", "1-", "-1", "3-1", "1,,x", "0-3;8", "99999999"}) {
+        try {
+            parse_cpu_list(text);
+            fail("parse_cpu_list(\"" + text + "\") accepted a malformed list");
+        } catch (std::runtime_error const &) {
+        }
+    }
+}
+
+void check_discover() {
+    std::vector<unsigned> const allowed{thread_cpus()};
+    std::filesystem::path const root{std::filesystem::temp_directory_path() /
+                                     ("m-queens3-numa-test-" + std::to_string(getpid()))};
+    auto write = [&](std::string const &dir, std::string const &list) {
+        std::filesystem::create_directories(root / dir);
+        std::ofstream{root / dir / "cpulist"} << list;
+    };
+    // node1 has every allowed CPU and one which isn't, node2 has only memory, the others are no nodes
+    std::string foreign;
+    if (allowed.back() + 1 < CPU_SETSIZE) {
+        foreign = "," + std::to_string(allowed.back() + 1);
+    }
+    write("node1", join(allowed) + foreign + "\n");
+    write("node0", std::to_string(allowed.front()) + "\n");
+    write("node2", "\n");
+    write("nodes", "0\n");
+    std::filesystem::create_directories(root / "node3");
+
+    numa_topology const topology{numa_topology::discover(root.string())};
+    if (topology.nodes.size() != 2 || topology.nodes[0].id != 0 ||
+        topology.nodes[0].cpus != std::vector<unsigned>{allowed.front()} || topology.nodes[1].id != 1 ||
+        topology.nodes[1].cpus != allowed) {
+        fail("discover() on the fake sysfs tree found other nodes");
+    }
+
+    write("node4", "0-x\n");
+    try {
+        numa_topology::discover(root.string());
+        fail("discover() accepted a malformed cpulist");
+    } catch (std::runtime_error const &) {
+    }
+    std::filesystem::remove_all(root);
+
+    numa_topology const missing{numa_topology::discover(root.string())};
+    if (missing.nodes.size() != 1 || missing.nodes[0].id != 0 || missing.nodes[0].cpus != allowed) {
+        fail("discover() without sysfs didn't put all allowed CPUs into node 0");
+    }
+}
+
+void check_placement() {
+    numa_topology const topology{{{0, {0, 1, 2, 3}}, {1, {4, 5}}}};
+    struct placement_case {
+            unsigned workers;
+            std::vector<unsigned> nodes;
+            std::vector<unsigned> cpus;
+    };
+    for (placement_case const &c :
+         {placement_case{6, {0, 0, 0, 0, 1, 1}, {0, 1, 2, 3, 4, 5}},
+          placement_case{9, {0, 0, 0, 0, 0, 0, 1, 1, 1}, {0, 1, 2, 3, 0, 1, 4, 5, 4}},
+          placement_case{3, {0, 0, 1}, {0, 1, 4}}, placement_case{1, {0}, {0}}, placement_case{0, {}, {}}}) {
+        std::vector<unsigned> nodes;
+        std::vector<unsigned> cpus;
+        for (worker_placement const &p : place_workers(topology, c.workers)) {
+            nodes.push_back(p.node);
+            cpus.push_back(p.cpu);
+        }
+        if (nodes != c.nodes || cpus != c.cpus) {
+            fail("place_workers() of " + std::to_string(c.workers) + " workers gave nodes " + join(nodes) +
+                 " and CPUs " + join(cpus));
+        }
+    }
+}
+
+void check_solve(uint8_t N, uint8_t ring_width) {
+    std::array<std::vector<mini_board>, ALL_SYMMETRIES.size()> boards;
+    std::array<std::vector<packed_unit>, ALL_SYMMETRIES.size()> packed;
+    bool const pack = packed_unit::fits(N, ring_width);
+    {
+        // preplace() reports its progress, which would drown the result
+        std::ostringstream mute;
+        std::streambuf *const out = std::cout.rdbuf(mute.rdbuf());
+        preplace(N, [&](Board const &brd, Symmetry::Direction sym) {
+            if (pack) {
+                packed[Symmetry{sym}].push_back(packed_unit::pack(brd, ring_width));
+            } else {
+                boards[Symmetry{sym}].emplace_back(brd, ring_width);
+            }
+        }, ring_width);
+        std::cout.rdbuf(out);
+    }
+
+    isa_variant const *const isa{&best_isa_variant()};
+    unsigned const cpu{thread_cpus().front()};
+    solve_plan plan{isa, isa->select("recursive", N), N, ring_width, {}, {}, {}, 3, 0, {}, {}, false};
+    std::array<size_t, ALL_SYMMETRIES.size()> units;
+    for (Symmetry const &sym : ALL_SYMMETRIES) {
+        plan.work[sym] = pack ? unit_span{packed[sym], N, ring_width} : unit_span{boards[sym]};
+        units[sym] = plan.work[sym].size();
+    }
+    plan.chunks = list_chunks(units, {});
+    // Both nodes share the one CPU the test may be restricted to
+    plan.topology.nodes = {{0, {cpu}}, {1, {cpu}}};
+    plan.placement = place_workers(plan.topology, plan.threads);
+
+    bool copied = false;
+    solve_hooks hooks;
+    hooks.copied = [&](double) { copied = true; };
+    solve_outcome const outcome{solve_chunks(plan, hooks)};
+
+    uint64_t total = 0;
+    for (Symmetry const &sym : ALL_SYMMETRIES) {
+        total += outcome.counts[sym] * sym.weight();
+    }
+    std::string const what{"N=" + std::to_string(N) + ", ring width " + std::to_string(ring_width) + ": "};
+    if (!copied) {
+        fail(what + "the units weren't copied to the nodes");
+    }
+    if (total != results[N - 1]) {
+        fail(what + "solved " + std::to_string(total) + " instead of " + std::to_string(results[N - 1]));
+    }
+}
+
+} // namespace
+
+int main() {
+    check_parse();
+    check_discover();
+    check_placement();
+    check_solve(12, 2);
+    check_solve(12, 4);
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "board.hpp"
+#include "mini_board.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace queens {
+
+/**
+ * @brief Work unit stored as the coronal placement it came from, 8 bytes instead of the 24 of mini_board.
+ *
+ * Field i of FIELD_BITS bits holds value i of Board::coronal(): the rows of the queens on the first ring_width
+ * columns, then the same for the other three sides, each side seen from its own corner. Queens in the corners of the
+ * ring are stored twice. That needs 4 * ring_width fields, so ring widths up to MAX_RING_WIDTH fit.
+ */
+struct packed_unit {
+        static constexpr unsigned FIELD_BITS = 5;
+        static constexpr unsigned MAX_RING_WIDTH = 3;
+
+        uint64_t bits;
+
+        /**
+         * @brief Check if the preplacements of a board size and ring width can be packed.
+         */
+        static constexpr bool fits(uint8_t n, uint8_t ring_width) {
+            return n <= (1u << FIELD_BITS) && ring_width <= MAX_RING_WIDTH;
+        }
+
+        /**
+         * @brief Pack a coronal preplacement, fits() must hold.
+         */
+        static packed_unit pack(Board const &brd, uint8_t ring_width) {
+            assert(fits(brd.N, ring_width));
+            std::array<int8_t, 4 * MAX_RING_WIDTH> coronal;
+            brd.coronal(coronal.data(), ring_width);
+            uint64_t bits = 0;
+            for (unsigned i = 0; i < 4u * ring_width; i++) {
+                assert(coronal[i] >= 0);
+                bits |= static_cast<uint64_t>(coronal[i]) << (FIELD_BITS * i);
+            }
+            return {bits};
+        }
+
+        /**
+         * @brief Decode to the masks of a mini_board, without branches on the placement.
+         */
+        mini_board unpack(uint8_t n, uint8_t ring_width) const {
+            uint64_t bv = 0;
+            uint64_t bh = 0;
+            uint64_t bu = 0;
+            uint64_t bd = 0;
+            auto queen = [&](unsigned x, unsigned y) {
+                bv |= uint64_t{1} << x;
+                bh |= uint64_t{1} << y;
+                bu |= uint64_t{1} << (n - 1 - x + y);
+                bd |= uint64_t{1} << (x + y);
+            };
+            constexpr uint64_t field_mask = (1u << FIELD_BITS) - 1;
+            uint64_t b = bits;
+            for (unsigned j = 0; j < ring_width; j++, b >>= FIELD_BITS) {
+                queen(j, b & field_mask);
+            }
+            for (unsigned j = 0; j < ring_width; j++, b >>= FIELD_BITS) {
+                queen(b & field_mask, n - 1 - j);
+            }
+            for (unsigned j = 0; j < ring_width; j++, b >>= FIELD_BITS) {
+                queen(n - 1 - j, n - 1 - (b & field_mask));
+            }
+            for (unsigned j = 0; j < ring_width; j++, b >>= FIELD_BITS) {
+                queen(n - 1 - (b & field_mask), j);
+            }
+            return {static_cast<uint32_t>(bv), static_cast<uint32_t>(bh), bu, bd};
+        }
+};
+
+static_assert(sizeof(packed_unit) == 8);
+
+/**
+ * @brief Work units of one symmetry class, either mini_board or packed_unit, without owning them.
+ *
+ * Packed units stay packed in memory, they are decoded where they are solved, a chunk at a time.
+ */
+class unit_span {
+        std::span<mini_board const> m_boards;
+        std::span<packed_unit const> m_packed;
+        uint8_t m_boardsize{0};
+        uint8_t m_ring_width{0};
+        bool m_is_packed{false};
+
+    public:
+        unit_span() = default;
+        unit_span(std::span<mini_board const> boards) : m_boards{boards} {}
+        unit_span(std::span<packed_unit const> packed, uint8_t n, uint8_t ring_width)
+            : m_packed{packed}, m_boardsize{n}, m_ring_width{ring_width}, m_is_packed{true} {}
+
+        bool packed() const { return m_is_packed; }
+        size_t size() const { return m_is_packed ? m_packed.size() : m_boards.size(); }
+        bool empty() const { return size() == 0; }
+
+        /**
+         * @brief The units unless they are packed, else empty.
+         */
+        std::span<mini_board const> boards() const { return m_boards; }
+
+        /**
+         * @brief The units if they are packed, else empty.
+         */
+        std::span<packed_unit const> packed_units() const { return m_packed; }
+
+        unit_span subspan(size_t first, size_t count) const {
+            unit_span sub{*this};
+            sub.m_boards = m_is_packed ? m_boards : m_boards.subspan(first, count);
+            sub.m_packed = m_is_packed ? m_packed.subspan(first, count) : m_packed;
+            return sub;
+        }
+
+        mini_board operator[](size_t i) const {
+            return m_is_packed ? m_packed[i].unpack(m_boardsize, m_ring_width) : m_boards[i];
+        }
+
+        /**
+         * @brief Get count units from first on as mini_board, decoded to buffer if they are packed.
+         * @param buffer Room for count units, only written to if the units are packed
+         */
+        mini_board const *decode(size_t first, size_t count, mini_board *buffer) const {
+            if (!m_is_packed) {
+                return m_boards.data() + first;
+            }
+            for (size_t i = 0; i < count; i++) {
+                buffer[i] = m_packed[first + i].unpack(m_boardsize, m_ring_width);
+            }
+            return buffer;
+        }
+};
+
+} // namespace queens
@@ -0,0 +1,105 @@
+#include "pipeline.hpp"
+
+#include "instrument.hpp"
+
+using namespace queens;
+
+solve_pipeline::solve_pipeline(SolverEngine engine, uint8_t boardsize, uint8_t ring_width, unsigned workers,
+                               size_t capacity)
+    : m_engine{engine}, m_boardsize{boardsize}, m_ring_width{ring_width}, m_queue{capacity}, m_counts(workers + 1) {
+    for (Symmetry const &sym : ALL_SYMMETRIES) {
+        m_filling[sym].sym = sym;
+        m_filling[sym].count = 0;
+    }
+    for (unsigned i = 0; i < workers; i++) {
+        m_workers.emplace_back(&solve_pipeline::work, this, i);
+    }
+}
+
+solve_pipeline::~solve_pipeline() { stop(); }
+
+void solve_pipeline::stop() {
+    m_done.store(true, std::memory_order_release);
+    m_pushes.fetch_add(1, std::memory_order_release);
+    m_pushes.notify_all();
+    for (std::thread &t : m_workers) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+void solve_pipeline::push(mini_board const &brd, Symmetry sym) {
+    batch &b = m_filling[sym];
+    b.units[b.count++] = brd;
+    if (b.count == b.units.size()) {
+        flush(b);
+    }
+}
+
+solve_pipeline::counts_t solve_pipeline::finish() {
+    for (batch &b : m_filling) {
+        if (b.count != 0) {
+            flush(b);
+        }
+    }
+
+    // Help draining the queue, then wait for the batches still in flight
+    batch b;
+    while (m_queue.try_pop(b)) {
+        solve(b, m_counts.back());
+    }
+    stop();
+
+    counts_t total{};
+    for (counts_t const &c : m_counts) {
+        for (size_t i = 0; i < total.size(); i++) {
+            total[i] += c[i];
+        }
+    }
+    return total;
+}
+
+void solve_pipeline::solve(batch const &b, counts_t &counts) const {
+    std::array<uint64_t, SOLVE_CHUNK> out;
+    instrument::busy_timer const busy;
+    m_engine(b.units.data(), b.count, m_boardsize, m_ring_width, out.data());
+    for (unsigned i = 0; i < b.count; i++) {
+        counts[b.sym] += out[i];
+    }
+}
+
+void solve_pipeline::flush(batch &b) {
+    while (!m_queue.try_push(b)) {
+        // Queue full, solve the oldest batch instead of waiting for a worker
+        batch oldest;
+        if (m_queue.try_pop(oldest)) {
+            solve(oldest, m_counts.back());
+        }
+    }
+    m_pushes.fetch_add(1, std::memory_order_release);
+    m_pushes.notify_one();
+    b.count = 0;
+}
+
+void solve_pipeline::work(unsigned idx) {
+    // Accumulate locally, neighbouring entries of m_counts share cache lines
+    counts_t counts{};
+    batch b;
+    for (;;) {
+        // Read before the pop, a push after a failed pop changes it and ends the wait
+        uint32_t const pushes = m_pushes.load(std::memory_order_acquire);
+        if (m_queue.try_pop(b)) {
+            solve(b, counts);
+        } else if (m_done.load(std::memory_order_acquire)) {
+            // The producer pushes nothing after setting done, so one more empty pop means the queue is drained
+            if (!m_queue.try_pop(b)) {
+                m_counts[idx] = counts;
+                return;
+            }
+            solve(b, counts);
+        } else {
+            m_pushes.wait(pushes, std::memory_order_acquire);
+        }
+    }
+}
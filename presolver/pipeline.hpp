@@ -0,0 +1,78 @@
+#pragma once
+
+#include "bounded_queue.hpp"
+#include "mini_board.hpp"
+#include "solver_engine.hpp"
+#include "symmetry.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief Solve work units while they are still generated.
+ *
+ * The producer collects units into batches of one symmetry class and hands them to the worker threads through a
+ * bounded queue, so memory is bounded by the queue capacity instead of the number of units. When the queue is full
+ * the producer solves a batch itself instead of waiting. Workers with an empty queue sleep until the next push.
+ */
+class solve_pipeline {
+    public:
+        using counts_t = std::array<uint64_t, ALL_SYMMETRIES.size()>;
+
+    private:
+        struct batch {
+                unsigned sym;
+                unsigned count;
+                std::array<mini_board, SOLVE_CHUNK> units;
+        };
+
+        SolverEngine const m_engine;
+        uint8_t const m_boardsize;
+        uint8_t const m_ring_width;
+        bounded_queue<batch> m_queue;
+        std::atomic<bool> m_done{false};
+        // Bumped on every push and on finish, workers wait for it to change once the queue is empty
+        std::atomic<uint32_t> m_pushes{0};
+        std::array<batch, ALL_SYMMETRIES.size()> m_filling;
+        // Per thread results, the producer uses the last entry
+        std::vector<counts_t> m_counts;
+        std::vector<std::thread> m_workers;
+
+    public:
+        /**
+         * @param engine Engine to solve the units with
+         * @param boardsize Size of the board
+         * @param ring_width Width of the coronal ring of the work units
+         * @param workers Number of worker threads, the producer solves batches too, so one less than the threads
+         * to keep busy
+         * @param capacity Number of batches the queue can hold, must be a power of two
+         */
+        solve_pipeline(SolverEngine engine, uint8_t boardsize, uint8_t ring_width, unsigned workers, size_t capacity);
+        ~solve_pipeline();
+        solve_pipeline(solve_pipeline const &) = delete;
+        solve_pipeline &operator=(solve_pipeline const &) = delete;
+
+        /**
+         * @brief Queue a work unit, must not be called concurrently.
+         */
+        void push(mini_board const &brd, Symmetry sym);
+
+        /**
+         * @brief Solve all remaining units and stop the workers.
+         * @return Number of completions per symmetry class, not weighted.
+         */
+        counts_t finish();
+
+    private:
+        void solve(batch const &b, counts_t &counts) const;
+        void flush(batch &b);
+        void stop();
+        void work(unsigned idx);
+};
+
+} // namespace queens
@@ -1,51 +1,201 @@
 #include "cxxopts.hpp"
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "autotune.hpp"
 #include "board.hpp"
+#include "chunk_solver.hpp"
+#include "commands.hpp"
 #include "coronal2.hpp"
 #include "cpu_solver_recursive.hpp"
+#include "dedup.hpp"
+#include "engines.hpp"
+#include "instrument.hpp"
+#include "journal.hpp"
 #include "mini_board.hpp"
+#include "numa.hpp"
+#include "packed_unit.hpp"
+#include "pipeline.hpp"
+#include "progress.hpp"
+#include "remote.hpp"
+#include "results.hpp"
+#include "shard.hpp"
+#include "solver_engine.hpp"
+#include "subproblem.hpp"
 #include "symmetry.hpp"
+#include "work_order.hpp"
+#include "workunit_file.hpp"
 
-// expected results from https://oeis.org/A000170
-static constexpr uint64_t results[27] = {
-    1ULL,   // N=1
-    0ULL,   // N=2
-    0ULL,   // N=3
-    2ULL,   // N=4
-    10ULL,  // N=5
-    4ULL,   // N=6
-    40ULL,
-    92ULL,
-    352ULL,
-    724ULL,
-    2680ULL,
-    14200ULL,
-    73712ULL,
-    365596ULL,
-    2279184ULL,
-    14772512ULL,
-    95815104ULL,
-    666090624ULL,
-    4968057848ULL,
-    39029188884ULL,
-    314666222712ULL,
-    2691008701644ULL,
-    24233937684440ULL,
-    227514171973736ULL,
-    2207893435808352ULL,
-    22317699616364044ULL,
-    234907967154122528ULL,
-};
-
-int main(int argc, char *argv[]) {
-    cxxopts::Options options("m-queens3-presolver", "This program generates work units for the m-queens3 solver");
+/**
+ * @brief Check an engine against the recursive engine on every preplacement for all N in results[] up to max_n.
+ * @param isa Feature level variant of the engines
+ * @param engine Name of the engine to check
+ * @param max_n Largest board size to check
+ * @param ring_width Width of the coronal ring
+ * @return true if all per unit counts match, false otherwise.
+ */
+static bool verify_engine(queens::isa_variant const &isa, std::string const &engine, uint8_t max_n,
+                          uint8_t ring_width) {
+    bool ok = true;
+    for (uint8_t n = std::max(5, 2 * ring_width + 1); n <= max_n && n <= std::size(results); n++) {
+        std::array<std::vector<queens::mini_board>, queens::ALL_SYMMETRIES.size()> preplacements;
+        preplace(n, [&](queens::Board const &brd, queens::Symmetry::Direction sym) {
+            preplacements[queens::Symmetry{sym}].push_back(queens::mini_board{brd, ring_width});
+        }, ring_width);
+
+        uint64_t total = 0;
+        uint64_t mismatches = 0;
+        for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+            std::vector<queens::mini_board> const &units = preplacements[sym];
+            std::vector<uint64_t> actual(units.size());
+            isa.select(engine, n)(units.data(), units.size(), n, ring_width, actual.data());
+
+            uint64_t l_counts = 0;
+#pragma omp parallel for reduction(+ : l_counts, mismatches) schedule(dynamic)
+            for (size_t i = 0; i < units.size(); i++) {
+                uint64_t nodes = 0;
+                mismatches += queens::countCompletions(units[i], n, ring_width, nodes) != actual[i];
+                l_counts += actual[i];
+            }
+            total += l_counts * sym.weight();
+        }
+
+        std::cout << "N=" << std::to_string(n) << ": " << std::to_string(mismatches) << " mismatching units, total "
+                  << (total == results[n - 1] ? "PASS" : "FAIL") << std::endl;
+        ok &= mismatches == 0;
+    }
+    return ok;
+}
+
+/**
+ * @brief Print the weighted completions per symmetry class and their total.
+ * @param counts Completions per symmetry class, not weighted
+ * @return Total number of solutions
+ */
+static uint64_t print_solutions(std::array<uint64_t, queens::ALL_SYMMETRIES.size()> const &counts) {
+    uint64_t const none = counts[queens::Symmetry(queens::Symmetry::Direction::NONE)] *
+                          queens::Symmetry(queens::Symmetry::Direction::NONE).weight();
+    uint64_t const point = counts[queens::Symmetry(queens::Symmetry::Direction::POINT)] *
+                           queens::Symmetry(queens::Symmetry::Direction::POINT).weight();
+    uint64_t const rotate = counts[queens::Symmetry(queens::Symmetry::Direction::ROTATE)] *
+                            queens::Symmetry(queens::Symmetry::Direction::ROTATE).weight();
+    uint64_t const total = none + point + rotate;
+
+    std::cout << "Solutions:" << std::endl;
+    std::cout << "NONE  : " << std::to_string(none) << std::endl;
+    std::cout << "POINT : " << std::to_string(point) << std::endl;
+    std::cout << "ROTATE: " << std::to_string(rotate) << std::endl;
+    std::cout << "------" << std::endl;
+    std::cout << "TOTAL : " << std::to_string(total) << std::endl;
+    return total;
+}
+
+/**
+ * @brief Combine the results of all shards of a solve and check the total.
+ * @param paths Result files of the shards
+ * @return true if the shards cover all work units exactly once and the total is right or unknown
+ */
+static bool merge_shards(std::vector<std::string> const &paths) {
+    std::vector<queens::shard_result> shards;
+    std::array<uint64_t, queens::ALL_SYMMETRIES.size()> counts;
+    try {
+        for (std::string const &path : paths) {
+            shards.push_back(queens::shard_result::read(path));
+        }
+        counts = queens::merge_shards(shards);
+    } catch (std::runtime_error const &e) {
+        std::cout << e.what() << std::endl;
+        return false;
+    }
+
+    uint8_t const boardsize = shards.front().boardsize;
+    std::cout << "Merged " << std::to_string(shards.size()) << " shards of boardsize " << std::to_string(boardsize)
+              << ", ring width " << std::to_string(shards.front().ring_width) << std::endl;
+    uint64_t const total = print_solutions(counts);
+    if (boardsize < 1 || boardsize > std::size(results)) {
+        std::cout << "No known result to check against" << std::endl;
+        return true;
+    }
+    std::cout << (results[boardsize - 1] == total ? "PASS" : "FAIL") << std::endl;
+    return results[boardsize - 1] == total;
+}
+
+/**
+ * @brief Solve work units for a coordinator with one connection per thread until it has none left.
+ * @return true if all connections ended because the coordinator was done
+ */
+static bool solve_remote(std::string const &address, queens::isa_variant const &isa, std::string const &engine,
+                         unsigned threads) {
+    std::cout << "Solving for " << address << " with " << std::to_string(threads) << " threads, engine: " << engine
+              << ", isa: " << isa.name << std::endl;
+    std::vector<size_t> batches(threads);
+    std::vector<std::string> errors(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            try {
+                batches[t] = queens::solve_remote(address, isa, engine);
+            } catch (std::runtime_error const &e) {
+                errors[t] = e.what();
+            }
+        });
+    }
+    for (std::thread &w : workers) {
+        w.join();
+    }
+
+    bool ok = true;
+    for (std::string const &error : errors) {
+        if (!error.empty()) {
+            std::cout << error << std::endl;
+            ok = false;
+        }
+    }
+    size_t const solved = std::accumulate(batches.begin(), batches.end(), size_t{0});
+    std::cout << "Solved " << std::to_string(solved) << " batches" << std::endl;
+    return ok;
+}
+
+int queens::presolver_main(std::string const &program, int argc, char *argv[]) {
+    cxxopts::Options options(program, "This program generates work units for the m-queens3 solver");
     // clang-format off
     options.add_options()
         ("N,boardsize", "Size of the board [5..32]", cxxopts::value<uint8_t>())
+        ("e,engine", "Solver engine [recursive, iterative, simd, fixed, tail, mitm], auto times all but the experimental mitm on a sample and takes the fastest", cxxopts::value<std::string>()->default_value("recursive"))
+        ("isa", "Use the engines built for this x86-64 feature level instead of the best one the CPU supports", cxxopts::value<std::string>())
+        ("ring-width", "Width of the coronal ring of preplaced queens", cxxopts::value<unsigned>()->default_value("2"))
+        ("verify", "Check the engine against the recursive engine for all N up to the boardsize")
+        ("o,output", "Write the work units to this file", cxxopts::value<std::string>())
+        ("i,input", "Solve the work units from this file instead of generating them", cxxopts::value<std::string>())
+        ("presolve-only", "Only generate work units, needs --output")
+        ("pipeline", "Solve work units while they are generated instead of storing all of them first")
+        ("dedup", "Solve work units which reduce to the same subproblem only once, few do (about 0.1% at ring width 2), so the extra pass usually costs more than it saves, see the dedup section of the benchmark")
+        ("shard", "Only solve shard <index>/<count> of the work units, index from 1", cxxopts::value<std::string>())
+        ("shard-result", "Write the result of --shard to this file instead of shard-<index>-of-<count>.txt", cxxopts::value<std::string>())
+        ("merge", "Combine the results of all shards of a solve from these files and check the total", cxxopts::value<std::vector<std::string>>())
+        ("split", "Split work units after this many search states while threads are idle, uses the iterative search, 0 disables", cxxopts::value<uint64_t>()->default_value("0"))
+        ("order", "Order of the work units [generated, cost], cost solves the predicted heaviest first", cxxopts::value<std::string>()->default_value("generated"))
+        ("serve", "Hand out the work units to workers which connect to this address, unix:<path> or <host>:<port>", cxxopts::value<std::string>())
+        ("connect", "Solve work units for the coordinator at this address, one connection per thread", cxxopts::value<std::string>())
+        ("lease", "Seconds a worker of --serve may take for a batch before it is given to another one", cxxopts::value<unsigned>()->default_value("600"))
+        ("journal", "Record solved work units in this file", cxxopts::value<std::string>())
+        ("resume", "Continue the solve recorded in --journal")
+        ("checkpoint-interval", "Seconds between two journal writes", cxxopts::value<unsigned>()->default_value("60"))
+        ("t,threads", "Number of solver threads, all hardware threads if not given", cxxopts::value<unsigned>())
+        ("progress", "Seconds between two progress reports while solving, 0 disables them", cxxopts::value<unsigned>()->default_value("10"))
+        ("metrics", "Write the progress as metrics in the Prometheus text format to this file at every progress report", cxxopts::value<std::string>())
+        ("numa", "Pin the solver threads to the CPUs of the NUMA nodes listed in sysfs, keep the work units of each node in its memory and only steal across nodes once a node runs dry")
+        ("queue-size", "Number of batches of work units buffered by --pipeline, power of two", cxxopts::value<size_t>()->default_value("1024"))
         ("h,help", "Print usage");
     // clang-format on
 
@@ -56,106 +206,574 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
-    if (result.count("boardsize") != 1) {
+    if (result.count("merge")) {
+        return ::merge_shards(result["merge"].as<std::vector<std::string>>()) ? 0 : -1;
+    }
+
+    auto engine_name{result["engine"].as<std::string>()};
+    if (!queens::known_engine(engine_name) && engine_name != queens::AUTO_ENGINE) {
+        std::cout << "Unknown engine: " << engine_name << std::endl;
+        return -1;
+    }
+
+    queens::isa_variant const *isa{&queens::best_isa_variant()};
+    if (result.count("isa")) {
+        auto const variants{queens::isa_variants()};
+        auto const it{std::find_if(variants.begin(), variants.end(), [&](queens::isa_variant const &v) {
+            return v.name == result["isa"].as<std::string>();
+        })};
+        if (it == variants.end() || !it->supported()) {
+            std::cout << "Feature level " << result["isa"].as<std::string>() << " is not built or not supported"
+                      << std::endl;
+            return -1;
+        }
+        isa = &*it;
+    }
+
+    const unsigned threads{result.count("threads") ? std::max(1u, result["threads"].as<unsigned>())
+                                                   : std::max(1u, std::thread::hardware_concurrency())};
+
+    if (result.count("connect")) {
+        return ::solve_remote(result["connect"].as<std::string>(), *isa, engine_name, threads) ? 0 : -1;
+    }
+
+    std::unique_ptr<queens::workunit_file_reader> input;
+    if (result.count("input")) {
+        try {
+            input = std::make_unique<queens::workunit_file_reader>(result["input"].as<std::string>());
+        } catch (std::runtime_error const &e) {
+            std::cout << e.what() << std::endl;
+            return -1;
+        }
+    }
+
+    if (result.count("boardsize") != 1 && !input) {
         std::cout << "Need exactly one board size!" << std::endl;
         return -1;
     }
 
-    const auto boardsize{result["boardsize"].as<uint8_t>()};
+    const auto boardsize{input ? input->boardsize() : result["boardsize"].as<uint8_t>()};
 
     if (boardsize < 5 || boardsize > 32) {
         std::cout << "Boardsize " << std::to_string(boardsize) << " is out of limits 5..32" << std::endl;
         return -1;
     }
 
-    // Compute preplacements
-    std::cout << "Running with boardsize: " << std::to_string(boardsize) << std::endl;
+    if (input && result.count("boardsize") && result["boardsize"].as<uint8_t>() != boardsize) {
+        std::cout << "Work unit file is for boardsize " << std::to_string(boardsize) << std::endl;
+        return -1;
+    }
+
+    if (input && result.count("ring-width") && result["ring-width"].as<unsigned>() != input->ring_width()) {
+        std::cout << "Work unit file is for ring width " << std::to_string(input->ring_width()) << std::endl;
+        return -1;
+    }
+    const uint8_t ring_width = input ? input->ring_width() : std::min(result["ring-width"].as<unsigned>(), 255u);
+
+    if (ring_width < 2 || 2 * ring_width >= boardsize) {
+        std::cout << "Ring width " << std::to_string(ring_width) << " is out of limits 2.."
+                  << std::to_string((boardsize - 1) / 2) << std::endl;
+        return -1;
+    }
+    if (boardsize > queens::subproblem::max_boardsize(ring_width)) {
+        std::cout << "Boardsize " << std::to_string(boardsize) << " needs a ring width of at least "
+                  << std::to_string((boardsize - 21) / 2) << std::endl;
+        return -1;
+    }
+
+    if (engine_name == queens::AUTO_ENGINE) {
+        engine_name = queens::autotune_engine(*isa, boardsize, ring_width, std::cout);
+    }
+
+    if (result.count("verify")) {
+        return verify_engine(*isa, engine_name, boardsize, ring_width) ? 0 : -1;
+    }
+
+    const bool presolve_only = result.count("presolve-only");
+    if (presolve_only && (input || !result.count("output"))) {
+        std::cout << "--presolve-only needs --output and no --input" << std::endl;
+        return -1;
+    }
+    if (input && result.count("output")) {
+        std::cout << "--output can't be combined with --input, the work units are read from the input" << std::endl;
+        return -1;
+    }
+
+    const bool pipelined = result.count("pipeline");
+    const auto queue_size{result["queue-size"].as<size_t>()};
+    if (pipelined && (input || presolve_only)) {
+        std::cout << "--pipeline can't be combined with --input or --presolve-only" << std::endl;
+        return -1;
+    }
+    const bool resume = result.count("resume");
+    if (resume && !result.count("journal")) {
+        std::cout << "--resume needs --journal" << std::endl;
+        return -1;
+    }
+    const bool dedup = result.count("dedup");
+    if (dedup && (pipelined || presolve_only)) {
+        std::cout << "--dedup can't be combined with --pipeline or --presolve-only" << std::endl;
+        return -1;
+    }
+    const auto order{result["order"].as<std::string>()};
+    if (order != "generated" && order != "cost") {
+        std::cout << "Unknown order: " << order << std::endl;
+        return -1;
+    }
+    const bool by_cost = order == "cost";
+    if (by_cost && (pipelined || presolve_only)) {
+        std::cout << "--order cost can't be combined with --pipeline or --presolve-only" << std::endl;
+        return -1;
+    }
+    const auto split_budget{result["split"].as<uint64_t>()};
+    if (split_budget != 0 && (pipelined || presolve_only)) {
+        std::cout << "--split can't be combined with --pipeline or --presolve-only" << std::endl;
+        return -1;
+    }
+    std::optional<queens::shard_spec> shard;
+    if (result.count("shard")) {
+        try {
+            shard = queens::shard_spec::parse(result["shard"].as<std::string>());
+        } catch (std::runtime_error const &e) {
+            std::cout << e.what() << std::endl;
+            return -1;
+        }
+        if (pipelined || presolve_only) {
+            std::cout << "--shard can't be combined with --pipeline or --presolve-only" << std::endl;
+            return -1;
+        }
+    }
+    const bool serve = result.count("serve");
+    if (serve && (pipelined || presolve_only || split_budget != 0)) {
+        std::cout << "--serve can't be combined with --pipeline, --presolve-only or --split" << std::endl;
+        return -1;
+    }
+    if (result.count("journal") && (pipelined || presolve_only)) {
+        std::cout << "--journal can't be combined with --pipeline or --presolve-only" << std::endl;
+        return -1;
+    }
+    const auto progress_interval{result["progress"].as<unsigned>()};
+    if (result.count("metrics") && (pipelined || presolve_only || progress_interval == 0)) {
+        std::cout << "--metrics can't be combined with --pipeline, --presolve-only or --progress 0" << std::endl;
+        return -1;
+    }
+    const bool numa = result.count("numa");
+    if (numa && (pipelined || presolve_only || serve)) {
+        std::cout << "--numa can't be combined with --pipeline, --presolve-only or --serve" << std::endl;
+        return -1;
+    }
+
+    if (queue_size < 2 || (queue_size & (queue_size - 1)) != 0) {
+        std::cout << "Queue size " << std::to_string(queue_size) << " is not a power of two" << std::endl;
+        return -1;
+    }
+
+    const queens::SolverEngine engine{isa->select(engine_name, boardsize)};
+
+    std::cout << "Running with boardsize: " << std::to_string(boardsize) << ", ring width: "
+              << std::to_string(ring_width) << ", engine: " << engine_name << ", isa: " << isa->name << std::endl;
     std::cout.precision(3);
 
     auto time_start = std::chrono::high_resolution_clock::now();
+    auto time_end = time_start;
+    std::chrono::duration<double> elapsed;
 
     std::array<std::vector<queens::mini_board>, queens::ALL_SYMMETRIES.size()> preplacements;
-
-    // Histogram over the number of queens placed per preplacement
-    std::array<uint64_t, 8> placed_cnt_histogram{};
-
-    auto storer = [&](queens::Board const &brd, queens::Symmetry::Direction sym) {
-        preplacements[queens::Symmetry{sym}].push_back(brd);
-        if (brd.getPlaced() > placed_cnt_histogram.size()) {
-            std::cout << "Error, out of range: " << std::to_string(brd.getPlaced()) << std::endl;
+    // Preplacements instead of the ones above where packed_unit::fits(), they are decoded a chunk at a time
+    std::array<std::vector<queens::packed_unit>, queens::ALL_SYMMETRIES.size()> packed_preplacements;
+    bool const pack = queens::packed_unit::fits(boardsize, ring_width);
+    // Work units to solve, either owned by the preplacements or mapped from the input file
+    std::array<queens::unit_span, queens::ALL_SYMMETRIES.size()> work;
+    // Replace the work units of a class with the ones derive(units, owned) stores in owned, in the same form
+    auto rederive = [&](queens::Symmetry sym, auto &&derive) {
+        if (work[sym].packed()) {
+            derive(work[sym].packed_units(), packed_preplacements[sym]);
+            work[sym] = {packed_preplacements[sym], boardsize, ring_width};
         } else {
-            placed_cnt_histogram[brd.getPlaced() - 1]++;
+            derive(work[sym].boards(), preplacements[sym]);
+            work[sym] = queens::unit_span{preplacements[sym]};
         }
     };
+    // Solutions per symmetry class, not weighted
+    std::array<uint64_t, queens::ALL_SYMMETRIES.size()> counts{};
 
-    preplace(boardsize, storer);
+    if (input) {
+        for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+            work[sym] = input->units(sym);
+        }
+        std::cout << "Loaded work units from " << result["input"].as<std::string>() << std::endl;
+    } else { // Compute preplacements
+        std::unique_ptr<queens::workunit_file_writer> output;
+        if (result.count("output")) {
+            try {
+                output = std::make_unique<queens::workunit_file_writer>(result["output"].as<std::string>(), boardsize,
+                                                                         ring_width);
+            } catch (std::runtime_error const &e) {
+                std::cout << e.what() << std::endl;
+                return -1;
+            }
+        }
+
+        std::unique_ptr<queens::solve_pipeline> pipeline;
+        if (pipelined) {
+            pipeline = std::make_unique<queens::solve_pipeline>(engine, boardsize, ring_width,
+                                                                std::max(1u, threads - 1), queue_size);
+        }
 
-    auto time_end = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = time_end - time_start;
+        // Number of preplacements per symmetry class
+        std::array<size_t, queens::ALL_SYMMETRIES.size()> preplaced_cnt{};
 
-    { // Preplacement stats
-        std::cout << "Preplaced boards:" << std::endl;
-        size_t const none = preplacements[queens::Symmetry(queens::Symmetry::Direction::NONE)].size();
-        size_t const point = preplacements[queens::Symmetry(queens::Symmetry::Direction::POINT)].size();
-        size_t const rotate = preplacements[queens::Symmetry(queens::Symmetry::Direction::ROTATE)].size();
-        size_t const total = none + point + rotate;
+        // Histogram over the number of queens placed per preplacement, at most one per row and column of the ring
+        std::vector<uint64_t> placed_cnt_histogram(4 * ring_width);
 
-        size_t const board_obj_size = sizeof(queens::mini_board);
+        auto storer = [&](queens::Board const &brd, queens::Symmetry::Direction sym) {
+            queens::mini_board const unit{brd, ring_width};
+            preplaced_cnt[queens::Symmetry{sym}]++;
+            if (pipeline) {
+                pipeline->push(unit, sym);
+            } else if (!presolve_only && pack) {
+                packed_preplacements[queens::Symmetry{sym}].push_back(queens::packed_unit::pack(brd, ring_width));
+            } else if (!presolve_only) {
+                preplacements[queens::Symmetry{sym}].push_back(unit);
+            }
+            if (output) {
+                output->add(brd, sym);
+            }
+            if (brd.getPlaced() > placed_cnt_histogram.size()) {
+                std::cout << "Error, out of range: " << std::to_string(brd.getPlaced()) << std::endl;
+            } else {
+                placed_cnt_histogram[brd.getPlaced() - 1]++;
+            }
+        };
 
-        std::cout << "NONE  : " << std::to_string(none) << std::endl;
-        std::cout << "POINT : " << std::to_string(point) << std::endl;
-        std::cout << "ROTATE: " << std::to_string(rotate) << std::endl;
-        std::cout << "------" << std::endl;
-        std::cout << "TOTAL : " << std::to_string(total) << std::endl;
-        std::cout << "Memory: " << std::to_string(total * board_obj_size) << std::endl;
-        std::cout << "Time  : " << elapsed.count() << " seconds" << std::endl;
-        std::cout << "Preplaced counts: " << std::endl;
-        for (size_t i = 0; i < placed_cnt_histogram.size(); i++) {
-            std::cout << " [" << std::to_string(i + 1) << "] = " << std::to_string(placed_cnt_histogram[i]) << std::endl;
+        try {
+            preplace(boardsize, storer, ring_width);
+            if (output) {
+                output->close();
+            }
+            if (pipeline) {
+                counts = pipeline->finish();
+            }
+        } catch (std::runtime_error const &e) {
+            std::cout << e.what() << std::endl;
+            return -1;
         }
 
+        time_end = std::chrono::high_resolution_clock::now();
+        elapsed = time_end - time_start;
+
+        { // Preplacement stats
+            std::cout << "Preplaced boards:" << std::endl;
+            size_t const none = preplaced_cnt[queens::Symmetry(queens::Symmetry::Direction::NONE)];
+            size_t const point = preplaced_cnt[queens::Symmetry(queens::Symmetry::Direction::POINT)];
+            size_t const rotate = preplaced_cnt[queens::Symmetry(queens::Symmetry::Direction::ROTATE)];
+            size_t const total = none + point + rotate;
+
+            // With the pipeline only the queued and the filling batches are held in memory, next to the batches of
+            // the generator threads
+            size_t const held = pipelined ? (queue_size + queens::ALL_SYMMETRIES.size()) * queens::SOLVE_CHUNK : total;
+            size_t const board_obj_size =
+                pack && !pipelined ? sizeof(queens::packed_unit) : sizeof(queens::mini_board);
+
+            std::cout << "NONE  : " << std::to_string(none) << std::endl;
+            std::cout << "POINT : " << std::to_string(point) << std::endl;
+            std::cout << "ROTATE: " << std::to_string(rotate) << std::endl;
+            std::cout << "------" << std::endl;
+            std::cout << "TOTAL : " << std::to_string(total) << std::endl;
+            std::cout << "Memory: " << std::to_string(held * board_obj_size + preplace_buffer_bytes()) << std::endl;
+            std::cout << "Time  : " << elapsed.count() << " seconds" << std::endl;
+            std::cout << "Preplaced counts: " << std::endl;
+            for (size_t i = 0; i < placed_cnt_histogram.size(); i++) {
+                std::cout << " [" << std::to_string(i + 1) << "] = " << std::to_string(placed_cnt_histogram[i])
+                          << std::endl;
+            }
+        }
+
+        if (presolve_only) {
+            return 0;
+        }
+
+        for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+            work[sym] = pack ? queens::unit_span{packed_preplacements[sym], boardsize, ring_width}
+                             : queens::unit_span{preplacements[sym]};
+        }
     }
 
     std::cout << std::endl;
 
-    // Solve preplacements
+    // Solve preplacements, the pipeline already did while generating them
 
-    time_start = std::chrono::high_resolution_clock::now();
+    // Chunks in the order they were solved and the seconds spent on each, to check the cost model
+    std::vector<queens::chunk_ref> chunks;
+    std::vector<double> measured;
+    if (!pipelined) {
+        // Selection and order of the work units, to tell journals apart
+        std::string layout;
+        // Result of this shard, written after the solve
+        queens::shard_result shard_summary{};
+        if (shard) {
+            shard_summary.boardsize = boardsize;
+            shard_summary.ring_width = ring_width;
+            shard_summary.shard = *shard;
+            for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                auto const [first, last] = shard->range(work[sym].size());
+                shard_summary.units[sym] = work[sym].size();
+                shard_summary.list_checksum[sym] = queens::checksum(work[sym]);
+                shard_summary.range[sym] = {first, last};
+                work[sym] = work[sym].subspan(first, last - first);
+                shard_summary.range_checksum[sym] = queens::checksum(work[sym]);
+                std::cout << "Shard " << std::to_string(shard->index) << "/" << std::to_string(shard->count) << ", "
+                          << static_cast<char const *>(sym) << ": units " << std::to_string(first) << ".."
+                          << std::to_string(last) << " of " << std::to_string(shard_summary.units[sym]) << std::endl;
+            }
+            layout = "shard " + std::to_string(shard->index) + "/" + std::to_string(shard->count);
+        }
+        if (by_cost) {
+            layout += std::string{layout.empty() ? "" : " "} + "order cost";
+        }
 
-    std::array<uint64_t, queens::ALL_SYMMETRIES.size()> counts{};
+        // Number of work units each unit of work stands for, empty without dedup
+        std::array<std::vector<uint32_t>, queens::ALL_SYMMETRIES.size()> occurrences;
+        if (dedup) {
+            time_start = std::chrono::high_resolution_clock::now();
+            size_t total = 0;
+            size_t unique = 0;
+            for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                total += work[sym].size();
+                rederive(sym, [&](auto units, auto &owned) {
+                    auto deduped{queens::deduplicate(units, boardsize, ring_width)};
+                    owned = std::move(deduped.units);
+                    occurrences[sym] = std::move(deduped.occurrences);
+                });
+                unique += work[sym].size();
+            }
+            time_end = std::chrono::high_resolution_clock::now();
+            elapsed = time_end - time_start;
+            std::cout << "Deduplicated: " << std::to_string(unique) << " of " << std::to_string(total)
+                      << " work units are unique, ratio " << (total ? static_cast<double>(unique) / total : 1.0)
+                      << ", took " << elapsed.count() << " seconds" << std::endl;
+        }
+
+        // Predicted cost per work unit, empty in generation order
+        std::array<std::vector<double>, queens::ALL_SYMMETRIES.size()> costs;
+        if (by_cost) {
+            time_start = std::chrono::high_resolution_clock::now();
+            for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                rederive(sym, [&](auto units, auto &owned) {
+                    // Units mapped from the input file or the range of a shard are copied first
+                    if (units.data() != owned.data() || units.size() != owned.size()) {
+                        owned = std::vector(units.begin(), units.end());
+                    }
+                    costs[sym] = queens::sort_by_cost(owned, occurrences[sym], boardsize, ring_width);
+                });
+            }
+            time_end = std::chrono::high_resolution_clock::now();
+            elapsed = time_end - time_start;
+            std::cout << "Ordered work units by predicted cost, took " << elapsed.count() << " seconds" << std::endl;
+        }
 
-    for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
-        uint64_t l_counts = 0;
-#pragma omp parallel for reduction(+ : l_counts) schedule(dynamic)
-        for (queens::mini_board const &brd : preplacements[sym]) {
-            l_counts += queens::countCompletions(brd, boardsize);
+        // Number of work units per symmetry class
+        std::array<size_t, queens::ALL_SYMMETRIES.size()> unit_counts;
+        for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+            unit_counts[sym] = work[sym].size();
+        }
+
+        std::unique_ptr<queens::solve_journal> journal;
+        if (result.count("journal")) {
+            try {
+                journal = std::make_unique<queens::solve_journal>(
+                    result["journal"].as<std::string>(), boardsize, ring_width, layout, queens::SOLVE_CHUNK,
+                    unit_counts, resume, std::chrono::seconds{result["checkpoint-interval"].as<unsigned>()});
+            } catch (std::runtime_error const &e) {
+                std::cout << e.what() << std::endl;
+                return -1;
+            }
+            counts = journal->restored();
+            if (resume) {
+                std::cout << "Resuming, skipping " << std::to_string(journal->restored_chunks()) << " solved chunks"
+                          << std::endl;
+            }
+        }
+
+        time_start = std::chrono::high_resolution_clock::now();
+
+        // All chunks of all symmetry classes in one pool, heaviest first when ordered by cost
+        chunks = queens::list_chunks(unit_counts, costs);
+        measured.assign(by_cost ? chunks.size() : 0, -1);
+
+        // Work units of a chunk, the last one of a symmetry class may be short
+        auto chunk_units = [&](queens::chunk_ref const &chunk) {
+            size_t const first = chunk.chunk * queens::SOLVE_CHUNK;
+            return std::min(queens::SOLVE_CHUNK, unit_counts[chunk.sym] - first);
+        };
+
+        // Solved work units and completions, starting with the chunks restored from the journal
+        queens::solve_progress::counts_t total_units{};
+        queens::solve_progress::counts_t restored_units{};
+        for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+            total_units[sym] = unit_counts[sym];
+        }
+        if (journal) {
+            for (queens::chunk_ref const &chunk : chunks) {
+                if (journal->done(queens::Symmetry{static_cast<queens::Symmetry::Direction>(chunk.sym)},
+                                  chunk.chunk)) {
+                    restored_units[chunk.sym] += chunk_units(chunk);
+                }
+            }
+        }
+        queens::solve_progress progress{total_units, restored_units, counts};
+
+        queens::solve_plan plan{isa, engine, boardsize, ring_width, work, {}, chunks, threads, split_budget, {}, {},
+                                by_cost};
+        for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+            plan.occurrences[sym] = occurrences[sym];
+        }
+        if (numa) {
+            try {
+                plan.topology = queens::numa_topology::discover();
+            } catch (std::runtime_error const &e) {
+                std::cout << e.what() << std::endl;
+                return -1;
+            }
+            plan.placement = queens::place_workers(plan.topology, threads);
+            for (unsigned n = 0; n < plan.topology.nodes.size(); n++) {
+                auto const workers = std::count_if(plan.placement.begin(), plan.placement.end(),
+                                                   [&](queens::worker_placement const &p) { return p.node == n; });
+                std::cout << "NUMA node " << std::to_string(plan.topology.nodes[n].id) << ": "
+                          << std::to_string(plan.topology.nodes[n].cpus.size()) << " CPUs, "
+                          << std::to_string(workers) << " threads" << std::endl;
+            }
+        }
+
+        queens::solve_hooks hooks;
+        if (journal) {
+            hooks.done = [&](queens::Symmetry sym, size_t chunk) { return journal->done(sym, chunk); };
+        }
+        hooks.solved = [&](queens::Symmetry sym, size_t chunk, size_t units, uint64_t completions) {
+            if (journal) {
+                journal->record(sym, chunk, completions);
+            }
+            progress.add(sym, units, completions);
+        };
+        hooks.visited = [&](queens::Symmetry sym, uint64_t nodes) { progress.add_nodes(sym, nodes); };
+        hooks.copied = [&](double seconds) {
+            // The generated units are not needed anymore, units mapped from a file stay
+            for (queens::Symmetry const &sym : queens::ALL_SYMMETRIES) {
+                if (!preplacements[sym].empty() || !packed_preplacements[sym].empty()) {
+                    work[sym] = {};
+                    preplacements[sym] = {};
+                    packed_preplacements[sym] = {};
+                }
+            }
+            std::cout << "Copied the work units to their NUMA nodes, took " << seconds << " seconds" << std::endl;
+        };
+
+        std::optional<queens::progress_reporter> reporter;
+        if (progress_interval != 0) {
+            reporter.emplace(progress, boardsize, std::chrono::seconds{progress_interval},
+                             result.count("metrics") ? result["metrics"].as<std::string>() : std::string{}, std::cout);
+        }
+
+        if (serve) {
+            // Chunks the journal has no result for are solved by the workers
+            std::vector<queens::remote_batch> batches;
+            std::vector<size_t> batch_chunk;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                queens::Symmetry const sym{static_cast<queens::Symmetry::Direction>(chunks[i].sym)};
+                if (journal && journal->done(sym, chunks[i].chunk)) {
+                    continue;
+                }
+                size_t const first = chunks[i].chunk * queens::SOLVE_CHUNK;
+                size_t const count = std::min(queens::SOLVE_CHUNK, work[sym].size() - first);
+                batches.push_back({work[sym].subspan(first, count),
+                                   occurrences[sym].empty()
+                                       ? std::span<uint32_t const>{}
+                                       : std::span<uint32_t const>{occurrences[sym]}.subspan(first, count)});
+                batch_chunk.push_back(i);
+            }
+            try {
+                queens::coordinator coordinator{result["serve"].as<std::string>(), boardsize, ring_width,
+                                                std::move(batches),
+                                                std::chrono::seconds{result["lease"].as<unsigned>()}};
+                std::cout << "Serving " << std::to_string(batch_chunk.size()) << " batches on "
+                          << result["serve"].as<std::string>() << std::endl;
+                coordinator.serve([&](size_t batch, uint64_t completions) {
+                    queens::chunk_ref const &chunk = chunks[batch_chunk[batch]];
+                    queens::Symmetry const sym{static_cast<queens::Symmetry::Direction>(chunk.sym)};
+                    hooks.solved(sym, chunk.chunk, chunk_units(chunk), completions);
+                    counts[sym] += completions;
+                });
+                std::cout << "Reissued " << std::to_string(coordinator.reissued()) << " batches" << std::endl;
+            } catch (std::runtime_error const &e) {
+                std::cout << e.what() << std::endl;
+                return -1;
+            }
+        } else {
+            queens::solve_outcome outcome;
+            try {
+                outcome = queens::solve_chunks(plan, hooks);
+            } catch (std::runtime_error const &e) {
+                std::cout << e.what() << std::endl;
+                return -1;
+            }
+            for (size_t i = 0; i < counts.size(); i++) {
+                counts[i] += outcome.counts[i];
+            }
+            measured = std::move(outcome.seconds);
+            if (split_budget != 0) {
+                std::cout << "Split off " << std::to_string(outcome.split_off) << " subproblems" << std::endl;
+            }
+        }
+        if (reporter) {
+            reporter->stop();
+        }
+
+        if (journal) {
+            try {
+                journal->flush();
+            } catch (std::runtime_error const &e) {
+                std::cout << e.what() << std::endl;
+            }
+        }
+
+        if (shard) {
+            shard_summary.completions = counts;
+            std::string const path{result.count("shard-result") ? result["shard-result"].as<std::string>()
+                                                                : "shard-" + std::to_string(shard->index) + "-of-" +
+                                                                      std::to_string(shard->count) + ".txt"};
+            try {
+                shard_summary.write(path);
+            } catch (std::runtime_error const &e) {
+                std::cout << e.what() << std::endl;
+                return -1;
+            }
+            std::cout << "Wrote shard result to " << path << std::endl;
         }
-        counts[sym] = l_counts;
     }
 
     time_end = std::chrono::high_resolution_clock::now();
     elapsed = time_end - time_start;
 
     { // Solver stats
-        uint64_t const none = counts[queens::Symmetry(queens::Symmetry::Direction::NONE)] *
-                              queens::Symmetry(queens::Symmetry::Direction::NONE).weight();
-        uint64_t const point = counts[queens::Symmetry(queens::Symmetry::Direction::POINT)] *
-                               queens::Symmetry(queens::Symmetry::Direction::POINT).weight();
-        uint64_t const rotate = counts[queens::Symmetry(queens::Symmetry::Direction::ROTATE)] *
-                                queens::Symmetry(queens::Symmetry::Direction::ROTATE).weight();
-        uint64_t const total = none + point + rotate;
-
-        std::cout << "Solutions:" << std::endl;
-        std::cout << "NONE  : " << std::to_string(none) << std::endl;
-        std::cout << "POINT : " << std::to_string(point) << std::endl;
-        std::cout << "ROTATE: " << std::to_string(rotate) << std::endl;
-        std::cout << "------" << std::endl;
-        std::cout << "TOTAL : " << std::to_string(total) << std::endl;
+        uint64_t const total = print_solutions(counts);
         std::cout << "Time  : " << elapsed.count() << " seconds, ";
         std::cout << "Solutions/s " << total / elapsed.count() << std::endl;
 
-        std::cout << (results[boardsize - 1] == total ? "PASS" : "FAIL") << std::endl;
+        if (shard) {
+            std::cout << "Partial result of one shard, check the total with --merge" << std::endl;
+        } else if (boardsize > std::size(results)) {
+            std::cout << "No known result to check against" << std::endl;
+        } else {
+            std::cout << (results[boardsize - 1] == total ? "PASS" : "FAIL") << std::endl;
+        }
+    }
+
+    if (by_cost) {
+        queens::report_cost_model(std::cout, chunks, measured);
     }
 
+    queens::instrument::report(std::cout,
+                               std::chrono::duration_cast<std::chrono::steady_clock::duration>(time_end - time_start));
+
     return 0;
 }
@@ -0,0 +1,137 @@
+#include "progress.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using namespace queens;
+
+/**
+ * @brief Format seconds as h:mm:ss, or "unknown" if they are not finite.
+ */
+static std::string format_duration(double seconds) {
+    if (!std::isfinite(seconds)) {
+        return "unknown";
+    }
+    uint64_t const s = static_cast<uint64_t>(seconds + 0.5);
+    std::ostringstream out;
+    out << s / 3600 << ':' << std::setfill('0') << std::setw(2) << s / 60 % 60 << ':' << std::setw(2) << s % 60;
+    return out.str();
+}
+
+progress_reporter::progress_reporter(solve_progress const &progress, uint8_t boardsize,
+                                     std::chrono::steady_clock::duration interval, std::string metrics,
+                                     std::ostream &out)
+    : m_progress(progress), m_boardsize(boardsize), m_interval(interval), m_metrics(std::move(metrics)), m_out(out),
+      m_start(std::chrono::steady_clock::now()) {
+    for (Symmetry const &sym : ALL_SYMMETRIES) {
+        m_start_units += m_progress.units(sym);
+    }
+    m_thread = std::thread{[this] {
+        std::unique_lock<std::mutex> lock{m_lock};
+        while (!m_wake.wait_for(lock, m_interval, [this] { return m_stop; })) {
+            lock.unlock();
+            report(false);
+            lock.lock();
+        }
+    }};
+}
+
+progress_reporter::~progress_reporter() { stop(); }
+
+void progress_reporter::stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard{m_lock};
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+    report(true);
+}
+
+void progress_reporter::report(bool last) {
+    uint64_t total = 0;
+    uint64_t units = 0;
+    for (Symmetry const &sym : ALL_SYMMETRIES) {
+        total += m_progress.total(sym);
+        units += m_progress.units(sym);
+    }
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    double const rate = elapsed > 0 ? (units - m_start_units) / elapsed : 0;
+    double const eta = units >= total ? 0 : rate > 0 ? (total - units) / rate : std::numeric_limits<double>::infinity();
+
+    // Short solves end before the first report, they don't get a progress line
+    if (!last || m_printed) {
+        auto const precision = m_out.precision(3);
+        m_out << "\rSolved " << units << '/' << total << " work units ("
+            << (total ? 100.0 * units / total : 100.0) << "%), " << rate << " units/s, ETA " << format_duration(eta)
+            << "   " << (last ? "\n" : "") << std::flush;
+        m_out.precision(precision);
+        m_printed = true;
+    }
+    if (!m_metrics.empty()) {
+        write_metrics(elapsed, rate, eta, last && units >= total);
+    }
+}
+
+void progress_reporter::write_metrics(double elapsed, double rate, double eta, bool done) {
+    std::string const n{"boardsize=\"" + std::to_string(m_boardsize) + "\""};
+    std::ostringstream out;
+    auto header = [&](char const *name, char const *type, char const *help) {
+        out << "# HELP " << name << ' ' << help << '\n' << "# TYPE " << name << ' ' << type << '\n';
+    };
+    auto per_sym = [&](char const *name, auto &&value) {
+        for (Symmetry const &sym : ALL_SYMMETRIES) {
+            out << name << '{' << n << ",symmetry=\"" << static_cast<char const *>(sym) << "\"} " << value(sym)
+                << '\n';
+        }
+    };
+    // Prometheus spells the special values its own way
+    auto number = [](double value) -> std::string {
+        if (std::isnan(value)) {
+            return "NaN";
+        }
+        if (std::isinf(value)) {
+            return value > 0 ? "+Inf" : "-Inf";
+        }
+        std::ostringstream v;
+        v.precision(std::numeric_limits<double>::max_digits10);
+        v << value;
+        return v.str();
+    };
+
+    header("queens_work_units", "gauge", "Work units of the solve.");
+    per_sym("queens_work_units", [&](Symmetry sym) { return m_progress.total(sym); });
+    header("queens_work_units_solved_total", "counter", "Work units solved.");
+    per_sym("queens_work_units_solved_total", [&](Symmetry sym) { return m_progress.units(sym); });
+    header("queens_solutions_total", "counter", "Solutions found, weighted by symmetry.");
+    per_sym("queens_solutions_total", [&](Symmetry sym) { return m_progress.completions(sym) * sym.weight(); });
+    header("queens_search_nodes_total", "counter", "Search states visited by the engine, including the solutions.");
+    per_sym("queens_search_nodes_total", [&](Symmetry sym) { return m_progress.nodes(sym); });
+    header("queens_work_units_per_second", "gauge", "Work units solved per second since the solve started.");
+    out << "queens_work_units_per_second{" << n << "} " << number(rate) << '\n';
+    header("queens_eta_seconds", "gauge", "Estimated seconds until the solve is done.");
+    out << "queens_eta_seconds{" << n << "} " << number(eta) << '\n';
+    header("queens_elapsed_seconds", "gauge", "Seconds since the solve started.");
+    out << "queens_elapsed_seconds{" << n << "} " << number(elapsed) << '\n';
+    header("queens_solve_done", "gauge", "1 once all work units are solved.");
+    out << "queens_solve_done{" << n << "} " << (done ? 1 : 0) << '\n';
+
+    std::string const temp{m_metrics + ".tmp"};
+    std::ofstream file{temp, std::ios::binary | std::ios::trunc};
+    file << out.str();
+    file.close();
+    if (!file || std::rename(temp.c_str(), m_metrics.c_str()) != 0) {
+        std::remove(temp.c_str());
+        if (!m_failed) {
+            m_out << "\nCan't write metrics to " << m_metrics << std::endl;
+        }
+        m_failed = true;
+    }
+}
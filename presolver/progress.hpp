@@ -0,0 +1,119 @@
+#pragma once
+
+#include "symmetry.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace queens {
+
+/**
+ * @brief Progress of a solve, counted by the solver threads and read by a progress_reporter.
+ *
+ * The counters are only added to with relaxed atomics, once per solved chunk. Readers see every counter on its own,
+ * not a consistent snapshot of all of them. Search states are only counted from the start of this solve, a journal
+ * doesn't record them, and not for the work units of --serve, the workers only send back completions.
+ */
+class solve_progress {
+    public:
+        using counts_t = std::array<uint64_t, ALL_SYMMETRIES.size()>;
+
+    private:
+        // One cache line per symmetry class, so only threads solving the same class share one
+        struct alignas(64) sym_counters {
+                std::atomic<uint64_t> units;
+                std::atomic<uint64_t> completions;
+                std::atomic<uint64_t> nodes{0};
+        };
+
+        counts_t const m_total;
+        std::array<sym_counters, ALL_SYMMETRIES.size()> m_done;
+
+    public:
+        /**
+         * @param total Work units per symmetry class
+         * @param units Work units already solved, like the ones restored from a journal
+         * @param completions Completions of the solved units, not weighted
+         */
+        solve_progress(counts_t const &total, counts_t const &units, counts_t const &completions) : m_total(total) {
+            for (size_t i = 0; i < m_done.size(); i++) {
+                m_done[i].units.store(units[i], std::memory_order_relaxed);
+                m_done[i].completions.store(completions[i], std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Count solved work units of a symmetry class and their completions, not weighted.
+         */
+        void add(Symmetry sym, uint64_t units, uint64_t completions) {
+            m_done[sym].units.fetch_add(units, std::memory_order_relaxed);
+            m_done[sym].completions.fetch_add(completions, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Count search states the engine visited for a symmetry class, see SolverEngine.
+         */
+        void add_nodes(Symmetry sym, uint64_t nodes) { m_done[sym].nodes.fetch_add(nodes, std::memory_order_relaxed); }
+
+        uint64_t total(Symmetry sym) const { return m_total[sym]; }
+        uint64_t units(Symmetry sym) const { return m_done[sym].units.load(std::memory_order_relaxed); }
+        uint64_t completions(Symmetry sym) const { return m_done[sym].completions.load(std::memory_order_relaxed); }
+        uint64_t nodes(Symmetry sym) const { return m_done[sym].nodes.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief Background thread which reports the progress of a solve at a fixed interval.
+ *
+ * Each report rewrites the progress line with the throughput and the estimated time left, and replaces the metrics
+ * file if there is one. The throughput counts work units solved since the reporter started. The metrics are in the
+ * text format of Prometheus, for the textfile collector of its node exporter; the file is written next to its path
+ * and renamed, so it is never seen half written.
+ */
+class progress_reporter {
+        solve_progress const &m_progress;
+        uint8_t const m_boardsize;
+        std::chrono::steady_clock::duration const m_interval;
+        std::string const m_metrics;
+        std::ostream &m_out;
+        std::chrono::steady_clock::time_point const m_start;
+        uint64_t m_start_units{0};
+        bool m_printed{false};
+        bool m_failed{false}; // The metrics file could not be written, reported once
+
+        std::mutex m_lock;
+        std::condition_variable m_wake;
+        bool m_stop{false};
+        std::thread m_thread;
+
+    public:
+        /**
+         * @param progress Counters of the solve, must stay valid until stop() returns
+         * @param boardsize Size of the board, a label of the metrics
+         * @param interval Time between two reports
+         * @param metrics Path of the metrics file, or empty for none
+         * @param out Receives the progress lines
+         */
+        progress_reporter(solve_progress const &progress, uint8_t boardsize,
+                          std::chrono::steady_clock::duration interval, std::string metrics, std::ostream &out);
+        ~progress_reporter();
+        progress_reporter(progress_reporter const &) = delete;
+        progress_reporter &operator=(progress_reporter const &) = delete;
+
+        /**
+         * @brief Stop the thread and make a last report, which ends the progress line.
+         */
+        void stop();
+
+    private:
+        void report(bool last);
+        void write_metrics(double elapsed, double rate, double eta, bool done);
+};
+
+} // namespace queens
@@ -0,0 +1,460 @@
+#include "remote.hpp"
+
+#include "autotune.hpp"
+#include "packed_unit.hpp"
+#include "solver_engine.hpp"
+#include "subproblem.hpp"
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace queens;
+
+static constexpr char const *HELLO = "HELLO 2";
+static constexpr char const *UNIX_PREFIX = "unix:";
+// Longest line either side accepts, a unit line is far shorter
+static constexpr size_t MAX_LINE = 256;
+// Largest batch a worker accepts
+static constexpr size_t MAX_BATCH = 1 << 16;
+static constexpr unsigned WAIT_MS = 200;
+// How long the coordinator waits for workers with duplicate leases after all batches are solved
+static constexpr std::chrono::seconds DRAIN{10};
+
+/**
+ * @brief Check that every field of a packed unit is a row or column of the board and the unused bits are clear.
+ */
+static bool packed_fields_valid(packed_unit packed, uint8_t n, uint8_t ring_width) {
+    uint64_t bits = packed.bits;
+    for (unsigned i = 0; i < 4u * ring_width; i++, bits >>= packed_unit::FIELD_BITS) {
+        if ((bits & ((1u << packed_unit::FIELD_BITS) - 1)) >= n) {
+            return false;
+        }
+    }
+    return bits == 0;
+}
+
+static std::runtime_error socket_error(std::string const &what, std::string const &address) {
+    return std::runtime_error("Can't " + what + " " + address + ": " + std::strerror(errno));
+}
+
+/**
+ * @brief Send small messages right away instead of waiting for the acknowledgement of the previous one.
+ */
+static void no_delay(int fd) {
+    int const one = 1;
+    // Fails for Unix domain sockets, which never delay
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/**
+ * @brief Resolve an address and create a socket for it, for listen or connect.
+ * @param unix_path Set to the path for Unix domain sockets, cleared for TCP
+ */
+static int open_socket(std::string const &address, bool listen, std::string &unix_path) {
+    unix_path.clear();
+    if (address.rfind(UNIX_PREFIX, 0) == 0) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::string const path{address.substr(std::strlen(UNIX_PREFIX))};
+        if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("Invalid socket path in " + address);
+        }
+        std::copy(path.begin(), path.end(), addr.sun_path);
+
+        int const fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw socket_error("create a socket for", address);
+        }
+        auto const *sa = reinterpret_cast<sockaddr const *>(&addr);
+        if (listen) {
+            int res = ::bind(fd, sa, sizeof(addr));
+            // A socket file nobody accepts on is left over from an earlier run
+            if (res != 0 && errno == EADDRINUSE) {
+                int const probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+                if (probe >= 0 && ::connect(probe, sa, sizeof(addr)) != 0 && errno == ECONNREFUSED) {
+                    ::unlink(path.c_str());
+                    res = ::bind(fd, sa, sizeof(addr));
+                } else {
+                    errno = EADDRINUSE;
+                }
+                if (probe >= 0) {
+                    ::close(probe);
+                }
+            }
+            if (res != 0 || ::listen(fd, SOMAXCONN) != 0) {
+                ::close(fd);
+                throw socket_error("listen on", address);
+            }
+            unix_path = path;
+        } else if (::connect(fd, sa, sizeof(addr)) != 0) {
+            ::close(fd);
+            throw socket_error("connect to", address);
+        }
+        return fd;
+    }
+
+    size_t const colon = address.rfind(':');
+    if (colon == std::string::npos) {
+        throw std::runtime_error("Invalid address " + address + ", expected unix:<path> or <host>:<port>");
+    }
+    std::string host{address.substr(0, colon)};
+    std::string const port{address.substr(colon + 1)};
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listen ? AI_PASSIVE : 0;
+    addrinfo *found = nullptr;
+    if (int const res = ::getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found); res != 0) {
+        throw std::runtime_error("Can't resolve " + address + ": " + ::gai_strerror(res));
+    }
+
+    int fd = -1;
+    for (addrinfo *ai = found; ai != nullptr && fd < 0; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        int const one = 1;
+        bool const ok = listen ? ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == 0 &&
+                                     ::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, SOMAXCONN) == 0
+                               : ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+        if (!ok) {
+            int const error = errno;
+            ::close(fd);
+            fd = -1;
+            errno = error;
+        }
+    }
+    ::freeaddrinfo(found);
+    if (fd < 0) {
+        throw socket_error(listen ? "listen on" : "connect to", address);
+    }
+    no_delay(fd);
+    return fd;
+}
+
+static bool send_all(int fd, std::string const &data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t const res = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (res < 0 && errno == EINTR) {
+            continue;
+        }
+        if (res <= 0) {
+            return false;
+        }
+        sent += res;
+    }
+    return true;
+}
+
+coordinator::coordinator(std::string const &address, uint8_t boardsize, uint8_t ring_width,
+                         std::vector<remote_batch> batches, std::chrono::steady_clock::duration lease)
+    : m_address{address}, m_boardsize{boardsize}, m_ring_width{ring_width}, m_batches{std::move(batches)},
+      m_lease{lease}, m_leases(m_batches.size(), {{}, 0, false}), m_open{m_batches.size()} {
+    m_listen = open_socket(address, true, m_unix_path);
+}
+
+coordinator::~coordinator() {
+    for (client const &c : m_clients) {
+        ::close(c.fd);
+    }
+    ::close(m_listen);
+    if (!m_unix_path.empty()) {
+        ::unlink(m_unix_path.c_str());
+    }
+}
+
+void coordinator::serve(std::function<void(size_t batch, uint64_t completions)> const &solved) {
+    // Once all batches are solved, keep answering until the workers got their DONE and disconnected
+    std::chrono::steady_clock::time_point drain_end = std::chrono::steady_clock::time_point::max();
+    std::vector<pollfd> fds;
+    while (m_open > 0 || (!m_clients.empty() && std::chrono::steady_clock::now() < drain_end)) {
+        if (m_open == 0 && drain_end == std::chrono::steady_clock::time_point::max()) {
+            drain_end = std::chrono::steady_clock::now() + DRAIN;
+        }
+        fds.assign(1, {m_listen, POLLIN, 0});
+        for (client const &c : m_clients) {
+            fds.push_back({c.fd, POLLIN, 0});
+        }
+        if (::poll(fds.data(), fds.size(), WAIT_MS) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw socket_error("wait for workers on", m_address);
+        }
+
+        // Backwards, so dropping a client keeps the indices of the ones before it
+        for (size_t i = m_clients.size(); i-- > 0;) {
+            if (fds[i + 1].revents != 0 && !receive(m_clients[i], solved)) {
+                release(m_clients[i].id);
+                ::close(m_clients[i].fd);
+                m_clients.erase(m_clients.begin() + i);
+            }
+        }
+        if ((fds[0].revents & POLLIN) != 0 && m_open > 0) {
+            accept_client();
+        }
+    }
+}
+
+void coordinator::accept_client() {
+    int const fd = ::accept4(m_listen, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0) {
+        no_delay(fd);
+        m_clients.push_back({fd, m_next_client++, {}, false});
+    }
+}
+
+bool coordinator::receive(client &c, std::function<void(size_t, uint64_t)> const &solved) {
+    char buffer[4096];
+    ssize_t const res = ::recv(c.fd, buffer, sizeof(buffer), 0);
+    if (res < 0 && errno == EINTR) {
+        return true;
+    }
+    if (res <= 0) {
+        return false;
+    }
+    c.input.append(buffer, res);
+
+    size_t start = 0;
+    for (size_t end; (end = c.input.find('\n', start)) != std::string::npos; start = end + 1) {
+        if (!handle(c, c.input.substr(start, end - start), solved)) {
+            return false;
+        }
+    }
+    c.input.erase(0, start);
+    return c.input.size() <= MAX_LINE;
+}
+
+bool coordinator::handle(client &c, std::string const &line, std::function<void(size_t, uint64_t)> const &solved) {
+    if (!c.greeted) {
+        c.greeted = line == HELLO;
+        return c.greeted && send_all(c.fd, "JOB " + std::to_string(m_boardsize) + " " + std::to_string(m_ring_width) +
+                                               "\n");
+    }
+
+    std::istringstream in{line};
+    std::string command;
+    in >> command;
+    if (command == "GET") {
+        return send_batch(c);
+    }
+    size_t id;
+    uint64_t completions;
+    // Results are only taken for batches which were given out
+    if (command != "RESULT" || !(in >> id >> completions) || id >= m_next_batch) {
+        return false;
+    }
+    lease &l = m_leases[id];
+    if (!l.solved) {
+        l.solved = true;
+        l.client = 0;
+        m_open--;
+        solved(id, completions);
+    }
+    return true;
+}
+
+bool coordinator::send_batch(client &c) {
+    auto const now = std::chrono::steady_clock::now();
+    size_t id = m_batches.size();
+    if (m_next_batch < m_batches.size()) {
+        id = m_next_batch++;
+    } else {
+        for (size_t i = 0; i < m_leases.size(); i++) {
+            if (!m_leases[i].solved && (m_leases[i].client == 0 || m_leases[i].expires <= now)) {
+                id = i;
+                m_reissued++;
+                break;
+            }
+        }
+    }
+    if (id == m_batches.size()) {
+        return send_all(c.fd, m_open == 0 ? "DONE\n" : "WAIT " + std::to_string(WAIT_MS) + "\n");
+    }
+
+    m_leases[id].client = c.id;
+    m_leases[id].expires = now + m_lease;
+    remote_batch const &b = m_batches[id];
+    std::ostringstream out;
+    out << "BATCH " << id << ' ' << b.units.size() << '\n' << std::hex;
+    for (size_t i = 0; i < b.units.size(); i++) {
+        if (b.units.packed()) {
+            out << "P " << b.units.packed_units()[i].bits << ' ';
+        } else {
+            mini_board const &u = b.units.boards()[i];
+            out << "U " << u.getBV() << ' ' << u.getBH() << ' ' << u.getBU() << ' ' << u.getBD() << ' ';
+        }
+        out << std::dec << (b.weights.empty() ? 1 : b.weights[i]) << std::hex << '\n';
+    }
+    return send_all(c.fd, out.str());
+}
+
+void coordinator::release(uint64_t client) {
+    for (lease &l : m_leases) {
+        if (l.client == client) {
+            l.client = 0;
+        }
+    }
+}
+
+/**
+ * @brief Buffered line reader on a blocking socket.
+ */
+class line_reader {
+        int const m_fd;
+        std::string m_buffer;
+
+    public:
+        explicit line_reader(int fd) : m_fd{fd} {}
+
+        /**
+         * @brief Read the next line without its newline, throws std::runtime_error if the connection fails or closes.
+         */
+        std::string next() {
+            for (;;) {
+                size_t const end = m_buffer.find('\n');
+                if (end != std::string::npos) {
+                    std::string line{m_buffer.substr(0, end)};
+                    m_buffer.erase(0, end + 1);
+                    return line;
+                }
+                if (m_buffer.size() > MAX_LINE) {
+                    throw std::runtime_error("Coordinator sent an overlong line");
+                }
+                char buffer[4096];
+                ssize_t const res = ::recv(m_fd, buffer, sizeof(buffer), 0);
+                if (res < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (res <= 0) {
+                    throw std::runtime_error("Lost the connection to the coordinator");
+                }
+                m_buffer.append(buffer, res);
+            }
+        }
+};
+
+size_t queens::solve_remote(std::string const &address, isa_variant const &isa, std::string const &engine_name) {
+    std::string unix_path;
+    int const fd = open_socket(address, false, unix_path);
+    struct closer {
+            int fd;
+            ~closer() { ::close(fd); }
+    } const close_fd{fd};
+    line_reader reader{fd};
+    auto protocol_error = [&](std::string const &line) {
+        return std::runtime_error("Unexpected message from coordinator " + address + ": " + line);
+    };
+
+    if (!send_all(fd, std::string{HELLO} + "\n")) {
+        throw socket_error("send to", address);
+    }
+    std::string line{reader.next()};
+    std::string command;
+    unsigned n;
+    unsigned k;
+    if (!(std::istringstream{line} >> command >> n >> k) || command != "JOB" || n < 5 || n > 32 || k < 2 ||
+        2 * k >= n || n > subproblem::max_boardsize(k)) {
+        throw protocol_error(line);
+    }
+    std::string const chosen{engine_name == AUTO_ENGINE ? autotune_engine(isa, n, k, std::cout) : engine_name};
+    SolverEngine const engine{isa.select(chosen, n)};
+    if (engine == nullptr) {
+        throw std::runtime_error("Engine " + chosen + " can't solve boardsize " + std::to_string(n));
+    }
+    uint64_t const hv_mask = (uint64_t{1} << n) - 1;
+    uint64_t const diagonal_mask = (uint64_t{1} << (2 * n - 1)) - 1;
+
+    std::vector<mini_board> units;
+    std::vector<uint64_t> weights;
+    std::vector<uint64_t> out;
+    size_t batches = 0;
+    // The result of a batch goes out together with the request for the next one
+    std::string request{"GET\n"};
+    for (;;) {
+        if (!send_all(fd, request)) {
+            throw socket_error("send to", address);
+        }
+        line = reader.next();
+        std::istringstream in{line};
+        in >> command;
+        if (command == "DONE") {
+            return batches;
+        }
+        if (command == "WAIT") {
+            unsigned ms;
+            if (!(in >> ms)) {
+                throw protocol_error(line);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{std::min(ms, 60000u)});
+            request = "GET\n";
+            continue;
+        }
+        size_t id;
+        size_t count;
+        if (command != "BATCH" || !(in >> id >> count) || count > MAX_BATCH) {
+            throw protocol_error(line);
+        }
+
+        units.clear();
+        weights.clear();
+        for (size_t i = 0; i < count; i++) {
+            line = reader.next();
+            std::istringstream unit{line};
+            char tag;
+            uint64_t bv;
+            uint64_t bh;
+            uint64_t bu;
+            uint64_t bd;
+            uint64_t weight;
+            packed_unit packed;
+            if (!(unit >> tag)) {
+                throw protocol_error(line);
+            } else if (tag == 'P' && packed_unit::fits(n, k) && unit >> std::hex >> packed.bits >> std::dec >> weight &&
+                       packed_fields_valid(packed, n, k)) {
+                mini_board const decoded{packed.unpack(n, k)};
+                bv = decoded.getBV();
+                bh = decoded.getBH();
+                bu = decoded.getBU();
+                bd = decoded.getBD();
+            } else if (tag != 'U' || !(unit >> std::hex >> bv >> bh >> bu >> bd >> std::dec >> weight)) {
+                throw protocol_error(line);
+            }
+            // Conflicting queens of a packed unit share a row or column, which leaves the counts unequal
+            if ((bv & ~hv_mask) != 0 || (bh & ~hv_mask) != 0 || (bu & ~diagonal_mask) != 0 ||
+                (bd & ~diagonal_mask) != 0 || std::popcount(bv) != std::popcount(bh) ||
+                std::popcount(bu) != std::popcount(bh) || std::popcount(bd) != std::popcount(bh)) {
+                throw protocol_error(line);
+            }
+            units.emplace_back(static_cast<uint32_t>(bv), static_cast<uint32_t>(bh), bu, bd);
+            weights.push_back(weight);
+        }
+
+        out.resize(count);
+        engine(units.data(), count, n, k, out.data());
+        uint64_t completions = 0;
+        for (size_t i = 0; i < count; i++) {
+            completions += out[i] * weights[i];
+        }
+        request = "RESULT " + std::to_string(id) + " " + std::to_string(completions) + "\nGET\n";
+        batches++;
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "engines.hpp"
+#include "mini_board.hpp"
+#include "packed_unit.hpp"
+#include "symmetry.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace queens {
+
+/**
+ * Distributed solve over stream sockets: a coordinator owns the work units and leases batches of them to workers,
+ * which solve them with the usual engines and send back the completions.
+ *
+ * Addresses are "unix:<path>" for a Unix domain socket or "<host>:<port>" for TCP. The protocol is line based text,
+ * numbers are decimal except for the masks of the units, which are hexadecimal:
+ *   worker:      HELLO 2
+ *   coordinator: JOB <boardsize> <ring width>
+ *   worker:      GET
+ *   coordinator: BATCH <id> <count>, followed by count lines U <bv> <bh> <bu> <bd> <weight>
+ *                or P <packed_unit> <weight> for units stored packed
+ *                or WAIT <milliseconds> while all open batches are leased
+ *                or DONE once all batches are solved
+ *   worker:      RESULT <id> <sum of the completions of the units times their weights>, no reply
+ * A lease ends when it expires or when the connection of its worker closes, the batch is then given out again. Only
+ * the first result of a batch is counted.
+ */
+
+/**
+ * @brief Batch of work units of one symmetry class.
+ */
+struct remote_batch {
+        unit_span units;
+        std::span<uint32_t const> weights; // Occurrences of the units after dedup, or empty
+};
+
+/**
+ * @brief Hands out batches to workers until all of them are solved.
+ */
+class coordinator {
+        struct lease {
+                std::chrono::steady_clock::time_point expires;
+                uint64_t client; // Id of the connection holding the lease, 0 if none does
+                bool solved;
+        };
+
+        struct client {
+                int fd;
+                uint64_t id;
+                std::string input; // Received bytes not yet parsed into lines
+                bool greeted;
+        };
+
+        std::string const m_address;
+        uint8_t const m_boardsize;
+        uint8_t const m_ring_width;
+        std::vector<remote_batch> const m_batches;
+        std::chrono::steady_clock::duration const m_lease;
+        int m_listen{-1};
+        std::string m_unix_path; // Socket file to remove again, empty for TCP
+        std::vector<lease> m_leases;
+        std::vector<client> m_clients;
+        uint64_t m_next_client{1};
+        size_t m_next_batch{0}; // Batches before this one were given out at least once
+        size_t m_open;
+        size_t m_reissued{0};
+
+    public:
+        /**
+         * @brief Listen on the address, throws std::runtime_error on failure.
+         * @param address Address to listen on
+         * @param boardsize Size of the board
+         * @param ring_width Width of the coronal ring of the work units
+         * @param batches Batches to solve, the units must stay valid until serve() returns
+         * @param lease How long a worker may take for a batch before it is given to another one
+         */
+        coordinator(std::string const &address, uint8_t boardsize, uint8_t ring_width,
+                    std::vector<remote_batch> batches, std::chrono::steady_clock::duration lease);
+        ~coordinator();
+        coordinator(coordinator const &) = delete;
+        coordinator &operator=(coordinator const &) = delete;
+
+        /**
+         * @brief Serve workers until all batches are solved, throws std::runtime_error if the socket fails.
+         * @param solved Called once per batch with its index and weighted completions
+         */
+        void serve(std::function<void(size_t batch, uint64_t completions)> const &solved);
+
+        /**
+         * @brief Number of batches given out again after their lease ended.
+         */
+        size_t reissued() const { return m_reissued; }
+
+    private:
+        void accept_client();
+        bool receive(client &c, std::function<void(size_t, uint64_t)> const &solved);
+        bool handle(client &c, std::string const &line, std::function<void(size_t, uint64_t)> const &solved);
+        bool send_batch(client &c);
+        void release(uint64_t client);
+};
+
+/**
+ * @brief Solve batches of a coordinator on one connection until it has none left, throws std::runtime_error if the
+ * connection fails or the coordinator breaks the protocol.
+ * @param address Address of the coordinator
+ * @param isa Feature level variant of the engines
+ * @param engine Name of the engine to solve with, AUTO_ENGINE picks it once the board size is known
+ * @return Number of batches solved
+ */
+size_t solve_remote(std::string const &address, isa_variant const &isa, std::string const &engine);
+
+} // namespace queens
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+// expected results from https://oeis.org/A000170, known up to N=27, larger boards have no result to check against
+static constexpr uint64_t results[27] = {
+    1ULL,   // N=1
+    0ULL,   // N=2
+    0ULL,   // N=3
+    2ULL,   // N=4
+    10ULL,  // N=5
+    4ULL,   // N=6
+    40ULL,
+    92ULL,
+    352ULL,
+    724ULL,
+    2680ULL,
+    14200ULL,
+    73712ULL,
+    365596ULL,
+    2279184ULL,
+    14772512ULL,
+    95815104ULL,
+    666090624ULL,
+    4968057848ULL,
+    39029188884ULL,
+    314666222712ULL,
+    2691008701644ULL,
+    24233937684440ULL,
+    227514171973736ULL,
+    2207893435808352ULL,
+    22317699616364044ULL,
+    234907967154122528ULL,
+};
@@ -0,0 +1,198 @@
+#include "shard.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace queens;
+
+static constexpr char const *MAGIC = "m-queens3-shard 1";
+
+static constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+static constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+static uint64_t fnv1a(uint64_t hash, uint64_t value, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; i++) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xff)) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t fnv1a(std::string const &text) {
+    uint64_t hash = FNV_OFFSET;
+    for (char c : text) {
+        hash = fnv1a(hash, static_cast<unsigned char>(c), 1);
+    }
+    return hash;
+}
+
+shard_spec shard_spec::parse(std::string const &text) {
+    std::istringstream in{text};
+    shard_spec spec{};
+    char slash;
+    if (!(in >> spec.index >> slash >> spec.count) || slash != '/' || !in.eof() || spec.index < 1 ||
+        spec.index > spec.count) {
+        throw std::runtime_error("Invalid shard " + text + ", expected <index>/<count> with index in 1..count");
+    }
+    return spec;
+}
+
+uint64_t queens::checksum(unit_span units) {
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < units.size(); i++) {
+        mini_board const unit{units[i]};
+        hash = fnv1a(hash, unit.getBV(), 4);
+        hash = fnv1a(hash, unit.getBH(), 4);
+        hash = fnv1a(hash, unit.getBU(), 8);
+        hash = fnv1a(hash, unit.getBD(), 8);
+    }
+    return hash;
+}
+
+void shard_result::write(std::string const &path) const {
+    std::ostringstream out;
+    out << MAGIC << '\n';
+    out << "N " << std::dec << unsigned{boardsize} << " ring " << unsigned{ring_width} << " shard " << shard.index
+        << ' ' << shard.count << '\n';
+    for (unsigned sym = 0; sym < units.size(); sym++) {
+        out << "L " << std::dec << sym << ' ' << units[sym] << ' ' << std::hex << list_checksum[sym] << '\n';
+    }
+    for (unsigned sym = 0; sym < units.size(); sym++) {
+        out << "R " << std::dec << sym << ' ' << range[sym].first << ' ' << range[sym].second << ' '
+            << completions[sym] << ' ' << std::hex << range_checksum[sym] << '\n';
+    }
+    std::string const records{out.str()};
+
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file << records << "E " << std::hex << fnv1a(records) << '\n';
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Can't write shard result " + path);
+    }
+}
+
+shard_result shard_result::read(std::string const &path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw std::runtime_error("Can't open shard result " + path);
+    }
+    std::string const content{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    auto invalid = [&](std::string const &why) { return std::runtime_error("Shard result " + path + " " + why); };
+
+    // The E record covers everything before it, so a truncated or edited file is rejected
+    size_t const end = content.rfind("E ");
+    uint64_t expected;
+    if (end == std::string::npos || (end != 0 && content[end - 1] != '\n') ||
+        !(std::istringstream{content.substr(end + 2)} >> std::hex >> expected) ||
+        fnv1a(content.substr(0, end)) != expected) {
+        throw invalid("is incomplete or damaged");
+    }
+
+    std::istringstream lines{content.substr(0, end)};
+    std::string line;
+    if (!std::getline(lines, line) || line != MAGIC) {
+        throw invalid("is not a shard result");
+    }
+
+    shard_result result{};
+    unsigned boardsize;
+    unsigned ring_width;
+    std::string n_tag;
+    std::string ring_tag;
+    std::string shard_tag;
+    if (!std::getline(lines, line) ||
+        !(std::istringstream{line} >> n_tag >> boardsize >> ring_tag >> ring_width >> shard_tag >> result.shard.index >>
+          result.shard.count) ||
+        n_tag != "N" || ring_tag != "ring" || shard_tag != "shard" || boardsize > 255 || ring_width > 255 ||
+        result.shard.index < 1 || result.shard.index > result.shard.count) {
+        throw invalid("has an invalid header: " + line);
+    }
+    result.boardsize = boardsize;
+    result.ring_width = ring_width;
+
+    std::array<bool, ALL_SYMMETRIES.size()> listed{};
+    std::array<bool, ALL_SYMMETRIES.size()> ranged{};
+    while (std::getline(lines, line)) {
+        std::istringstream record{line};
+        char type;
+        unsigned sym;
+        bool ok = static_cast<bool>(record >> type >> std::dec >> sym) && sym < ALL_SYMMETRIES.size();
+        if (ok && type == 'L' && !listed[sym]) {
+            ok = static_cast<bool>(record >> result.units[sym] >> std::hex >> result.list_checksum[sym]);
+            listed[sym] = true;
+        } else if (ok && type == 'R' && !ranged[sym]) {
+            ok = static_cast<bool>(record >> result.range[sym].first >> result.range[sym].second >>
+                                   result.completions[sym] >> std::hex >> result.range_checksum[sym]);
+            ranged[sym] = true;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            throw invalid("has an invalid record: " + line);
+        }
+    }
+    for (unsigned sym = 0; sym < ALL_SYMMETRIES.size(); sym++) {
+        if (!listed[sym] || !ranged[sym]) {
+            throw invalid("misses the records of symmetry class " + std::to_string(sym));
+        }
+        if (result.range[sym].first > result.range[sym].second || result.range[sym].second > result.units[sym]) {
+            throw invalid("has a range outside of the list of symmetry class " + std::to_string(sym));
+        }
+    }
+    return result;
+}
+
+std::array<uint64_t, ALL_SYMMETRIES.size()> queens::merge_shards(std::vector<shard_result> const &shards) {
+    if (shards.empty()) {
+        throw std::runtime_error("No shard results to merge");
+    }
+    shard_result const &ref = shards.front();
+
+    std::vector<bool> seen(ref.shard.count);
+    for (shard_result const &s : shards) {
+        if (s.boardsize != ref.boardsize || s.ring_width != ref.ring_width || s.shard.count != ref.shard.count) {
+            throw std::runtime_error("Shard " + std::to_string(s.shard.index) + " is for another board, ring width " +
+                                     "or number of shards than shard " + std::to_string(ref.shard.index));
+        }
+        if (s.units != ref.units || s.list_checksum != ref.list_checksum) {
+            throw std::runtime_error("Shard " + std::to_string(s.shard.index) + " was cut from other work units than " +
+                                     "shard " + std::to_string(ref.shard.index));
+        }
+        if (seen[s.shard.index - 1]) {
+            throw std::runtime_error("Shard " + std::to_string(s.shard.index) + " is given twice");
+        }
+        seen[s.shard.index - 1] = true;
+    }
+    for (unsigned i = 0; i < seen.size(); i++) {
+        if (!seen[i]) {
+            throw std::runtime_error("Shard " + std::to_string(i + 1) + " of " + std::to_string(seen.size()) +
+                                     " is missing");
+        }
+    }
+
+    std::array<uint64_t, ALL_SYMMETRIES.size()> completions{};
+    for (unsigned sym = 0; sym < ALL_SYMMETRIES.size(); sym++) {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        for (shard_result const &s : shards) {
+            ranges.push_back(s.range[sym]);
+            completions[sym] += s.completions[sym];
+        }
+        std::sort(ranges.begin(), ranges.end());
+        size_t covered = 0;
+        for (auto const &[first, last] : ranges) {
+            if (first != covered) {
+                throw std::runtime_error(std::string{first > covered ? "Gap" : "Overlap"} + " at unit " +
+                                         std::to_string(std::min(first, covered)) + " of symmetry class " +
+                                         std::to_string(sym));
+            }
+            covered = last;
+        }
+        if (covered != ref.units[sym]) {
+            throw std::runtime_error("Gap at unit " + std::to_string(covered) + " of symmetry class " +
+                                     std::to_string(sym));
+        }
+    }
+    return completions;
+}
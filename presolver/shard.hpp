@@ -0,0 +1,87 @@
+#pragma once
+
+#include "mini_board.hpp"
+#include "packed_unit.hpp"
+#include "symmetry.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief Shard index of count shards, index is 1 based.
+ */
+struct shard_spec {
+        unsigned index;
+        unsigned count;
+
+        /**
+         * @brief Parse "<index>/<count>", throws std::runtime_error if it is malformed or index is not in 1..count.
+         */
+        static shard_spec parse(std::string const &text);
+
+        /**
+         * @brief Units [first, last) of a list of units which belong to this shard.
+         *
+         * Every shard gets one contiguous range, the ranges of all shards cover the list without gaps or overlaps.
+         */
+        std::pair<size_t, size_t> range(size_t units) const {
+            return {units * (index - 1) / count, units * index / count};
+        }
+};
+
+/**
+ * @brief FNV-1a hash over the masks of the work units, to check that shards were cut from the same list.
+ *
+ * Packed units are hashed decoded, so the checksum doesn't depend on the form the units are stored in.
+ */
+uint64_t checksum(unit_span units);
+
+/**
+ * @brief Result of one shard, one range of units per symmetry class.
+ *
+ * File format, one record per line:
+ *   m-queens3-shard 1
+ *   N <boardsize> ring <ring width> shard <index> <count>
+ *   L <symmetry> <units in the full list> <checksum of the full list>
+ *   R <symmetry> <first unit> <last unit> <completions> <checksum of the units of the range>
+ *   E <checksum of all previous lines>
+ * There is one L and one R record per symmetry class, given by its index, see Symmetry::Direction. Ranges are
+ * [first, last), completions are not weighted and checksums are hexadecimal.
+ */
+struct shard_result {
+        uint8_t boardsize;
+        uint8_t ring_width;
+        shard_spec shard;
+        std::array<size_t, ALL_SYMMETRIES.size()> units;
+        std::array<uint64_t, ALL_SYMMETRIES.size()> list_checksum;
+        std::array<std::pair<size_t, size_t>, ALL_SYMMETRIES.size()> range;
+        std::array<uint64_t, ALL_SYMMETRIES.size()> completions;
+        std::array<uint64_t, ALL_SYMMETRIES.size()> range_checksum;
+
+        /**
+         * @brief Write the result, throws std::runtime_error on failure.
+         */
+        void write(std::string const &path) const;
+
+        /**
+         * @brief Read and validate a result, throws std::runtime_error on failure.
+         */
+        static shard_result read(std::string const &path);
+};
+
+/**
+ * @brief Combine the results of all shards of a solve.
+ *
+ * Throws std::runtime_error unless the results are for the same board, ring width and list of units, every shard is
+ * present exactly once and the ranges of each symmetry class cover the list without gaps or overlaps.
+ * @return Completions per symmetry class, not weighted
+ */
+std::array<uint64_t, ALL_SYMMETRIES.size()> merge_shards(std::vector<shard_result> const &shards);
+
+} // namespace queens
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "instrument.hpp"
+#include "mini_board.hpp"
+#include "subproblem.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace queens {
+/**
+ * Solver engine, solves count work units of board size n and coronal ring width ring_width and stores the number of completions of units[i] in out[i].
+ * Returns the number of search states it visited, including the solutions. Engines which count solutions without
+ * visiting them, like the tail and mitm engines, visit fewer states for the same work units.
+ */
+using SolverEngine = uint64_t (*)(mini_board const *units, size_t count, uint8_t n, uint8_t ring_width, uint64_t *out);
+
+class split_sink;
+
+/**
+ * Solver engine which may split off parts of a long running subproblem for other threads and returns the count of the
+ * part it solved itself, see countCompletionsSplit(). The search states it visited are added to nodes.
+ */
+using SplitEngine = uint64_t (*)(subproblem const &sub, uint64_t budget, split_sink &sink, uint64_t &nodes);
+
+/**
+ * @brief Adapter to run an engine that solves a single work unit on a batch.
+ */
+template <uint64_t (*Solve)(mini_board const &, uint8_t, uint8_t, uint64_t &)>
+static uint64_t solve_each(mini_board const *units, size_t count, uint8_t n, uint8_t ring_width, uint64_t *out) {
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < count; i++) {
+        instrument::unit_timer const timer;
+        out[i] = Solve(units[i], n, ring_width, nodes);
+    }
+    return nodes;
+}
+
+// Number of work units handed to an engine at once
+static constexpr size_t SOLVE_CHUNK = 64;
+} // namespace queens
@@ -0,0 +1,44 @@
+#include "split_queue.hpp"
+
+using namespace queens;
+
+void split_queue::push(split_task const &task) {
+    {
+        std::lock_guard<std::mutex> guard{m_lock};
+        m_tasks.push_back(task);
+        m_published++;
+        m_size_hint.store(m_tasks.size(), std::memory_order_relaxed);
+    }
+    m_ready.notify_one();
+}
+
+bool split_queue::pop(split_task &task) {
+    std::unique_lock<std::mutex> guard{m_lock};
+    m_idle++;
+    m_idle_hint.store(m_idle, std::memory_order_relaxed);
+    // With every thread waiting nobody can publish anymore
+    while (m_tasks.empty() && m_idle < m_threads && !m_aborted) {
+        m_ready.wait(guard);
+    }
+    if (m_tasks.empty() || m_aborted) {
+        // Stay idle, so the other threads see that all threads wait
+        guard.unlock();
+        m_ready.notify_all();
+        return false;
+    }
+
+    task = m_tasks.front();
+    m_tasks.pop_front();
+    m_size_hint.store(m_tasks.size(), std::memory_order_relaxed);
+    m_idle--;
+    m_idle_hint.store(m_idle, std::memory_order_relaxed);
+    return true;
+}
+
+void split_queue::abort() {
+    {
+        std::lock_guard<std::mutex> guard{m_lock};
+        m_aborted = true;
+    }
+    m_ready.notify_all();
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "subproblem.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace queens {
+
+/**
+ * @brief Completions of a group of work units whose subproblems may be split across threads.
+ *
+ * The group is complete once its own solve and all published subproblems are done, see split_queue::complete().
+ */
+struct split_group {
+        std::atomic<uint64_t> completions{0}; // Weighted completions
+        std::atomic<uint32_t> pending{1};     // The own solve and the published subproblems not done yet
+};
+
+/**
+ * @brief Subproblem split off a work unit, with the group and the occurrence weight of the unit.
+ */
+struct split_task {
+        subproblem sub;
+        split_group *group;
+        uint32_t weight;
+};
+
+/**
+ * @brief Subproblems published by threads with long running work units for idle threads to take.
+ *
+ * Threads which run out of own work wait in pop(). Subproblems are only wanted while threads wait, so busy threads
+ * check hungry() before they split. The queue is drained once all threads wait and no subproblem is left.
+ */
+class split_queue {
+        unsigned const m_threads;
+        std::mutex m_lock;
+        std::condition_variable m_ready;
+        std::deque<split_task> m_tasks;
+        unsigned m_idle{0};
+        bool m_aborted{false};
+        size_t m_published{0};
+        // Copies for hungry(), which is called without the lock
+        std::atomic<unsigned> m_idle_hint{0};
+        std::atomic<size_t> m_size_hint{0};
+
+    public:
+        /**
+         * @param threads Number of threads which take part, every one of them has to end in pop()
+         */
+        explicit split_queue(unsigned threads) : m_threads{threads} {}
+
+        /**
+         * @brief Check if idle threads wait for more subproblems than are queued.
+         */
+        bool hungry() const {
+            return m_size_hint.load(std::memory_order_relaxed) < m_idle_hint.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Queue a subproblem, the caller must count it in the pending subproblems of its group first.
+         */
+        void push(split_task const &task);
+
+        /**
+         * @brief Take the oldest subproblem, waits while other threads may still publish some.
+         * @return false once all threads wait and the queue is empty, or after abort()
+         */
+        bool pop(split_task &task);
+
+        /**
+         * @brief Number of subproblems pushed so far.
+         */
+        size_t published() {
+            std::lock_guard<std::mutex> guard{m_lock};
+            return m_published;
+        }
+
+        /**
+         * @brief Release all waiting threads, for a thread that stops because of an error.
+         */
+        void abort();
+
+        /**
+         * @brief Finish one solve of a group, the own one or a subproblem.
+         * @return true if this was the last one, so the completions of the group are final
+         */
+        static bool complete(split_group &group) {
+            return group.pending.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+};
+
+/**
+ * @brief Where an engine publishes the subproblems it splits off the work unit it solves.
+ */
+class split_sink {
+        split_queue &m_queue;
+        split_group *m_group{nullptr};
+        uint32_t m_weight{1};
+
+    public:
+        explicit split_sink(split_queue &queue) : m_queue{queue} {}
+
+        /**
+         * @brief Attribute the following subproblems to a group, weighted with the occurrences of their unit.
+         */
+        void start(split_group &group, uint32_t weight) {
+            m_group = &group;
+            m_weight = weight;
+        }
+
+        bool hungry() const { return m_queue.hungry(); }
+
+        void publish(subproblem const &sub) {
+            m_group->pending.fetch_add(1, std::memory_order_relaxed);
+            m_queue.push({sub, m_group, m_weight});
+        }
+};
+
+} // namespace queens
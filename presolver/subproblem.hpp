@@ -0,0 +1,74 @@
+#pragma once
+
+#include "mini_board.hpp"
+#include <cassert>
+#include <cstdint>
+
+#include "../bithacks.hpp"
+
+namespace queens {
+/**
+ * @brief Search state the solver engines start from, derived from a preplaced board.
+ */
+struct subproblem {
+        uint32_t bv;
+        uint64_t bh;
+        uint64_t bu;
+        uint64_t bd;
+
+        /**
+         * @brief Largest board size the 64 bit diagonals can represent without losing conflicts for a ring width.
+         *
+         * The solver shifts bd right by one bit per column, so on the first free column it must already hold the
+         * diagonals of all free cells up to the last free column, see from().
+         */
+        static constexpr unsigned max_boardsize(uint8_t ring_width) {
+            unsigned const limit = 22 + 2 * ring_width;
+            return limit < 32 ? limit : 32;
+        }
+
+        /**
+         * @brief Strip the coronal ring from a preplaced board so only the inner columns are left to search.
+         *
+         * Row y of the board is mapped to bit y + s of bh. The diagonals are aligned so that on every inner column
+         * the bits of bu and bd in the same position as a row belong to the diagonals through that row. bu moves up
+         * by one bit per column, so on the first inner column its bits for the lowest free row of the last inner
+         * column are N - 1 - 2 * ring_width positions below that row. This gives the lowest s which keeps all of
+         * them: s = N - 1 - 3 * ring_width, which is N - 7 for coronal2.
+         * @param brd Preplaced board
+         * @param n Size of the board
+         * @param ring_width Width of the coronal ring of the preplacement
+         */
+        static subproblem from(mini_board const &brd, uint8_t n, uint8_t ring_width = 2) {
+            return reduce(brd, n, ring_width, bithacks::bits<uint32_t>(0, n - 1));
+        }
+
+        /**
+         * @brief Same as from(), but for a board size known at compile time, so the masks are constants.
+         */
+        template <unsigned N> static subproblem from(mini_board const &brd, uint8_t ring_width = 2) {
+            return reduce(brd, N, ring_width, bithacks::bits<0u, N - 1>());
+        }
+
+    private:
+        /**
+         * @param board_mask Bitmask where all bits which are a valid queen placement are '1'
+         */
+        static subproblem reduce(mini_board const &brd, unsigned N, unsigned k, uint64_t board_mask) {
+            assert(N <= max_boardsize(k) && N >= 2 * k + 1);
+
+            // Position of row 0 in bh
+            unsigned const s = N - 1 >= 3 * k ? N - 1 - 3 * k : 0;
+            // Bits dropped from bu and bd, bu is aligned for the first inner column without further shifts
+            unsigned const r = N - 1 - k - s;
+            // bd needs to be moved up again to reach the same alignment
+            unsigned const t = N - 1 - 2 * k;
+
+            const uint64_t bh_shifted = brd.getBH() << s;
+            const uint64_t board_mask_shifted = board_mask << s;
+            // Need to set all bits that are outside the board range to '1'
+            const uint64_t bh_new = bh_shifted | ~board_mask_shifted;
+            return {static_cast<uint32_t>(brd.getBV() >> k), bh_new, brd.getBU() >> r, (brd.getBD() >> r) << t};
+        }
+};
+} // namespace queens
@@ -0,0 +1,124 @@
+#include "work_order.hpp"
+
+#include "cost_model.hpp"
+#include "solver_engine.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+using namespace queens;
+
+// Packed units are decoded for the estimate only, they are sorted as they are
+static double cost_of(mini_board const &unit, uint8_t n, uint8_t ring_width) {
+    return estimateCost(unit, n, ring_width);
+}
+static double cost_of(packed_unit unit, uint8_t n, uint8_t ring_width) {
+    return estimateCost(unit.unpack(n, ring_width), n, ring_width);
+}
+
+template <typename Unit>
+static std::vector<double> sort_units(std::vector<Unit> &units, std::vector<uint32_t> &occurrences, uint8_t n,
+                                      uint8_t ring_width) {
+    std::vector<double> cost(units.size());
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < units.size(); i++) {
+        cost[i] = cost_of(units[i], n, ring_width);
+    }
+
+    // Stable, so the order only depends on the units and a journal can be resumed
+    std::vector<uint32_t> order(units.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return cost[a] > cost[b]; });
+
+    std::vector<Unit> sorted_units(units.size());
+    std::vector<double> sorted_cost(units.size());
+    std::vector<uint32_t> sorted_occurrences(occurrences.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted_units[i] = units[order[i]];
+        sorted_cost[i] = cost[order[i]];
+        if (!occurrences.empty()) {
+            sorted_occurrences[i] = occurrences[order[i]];
+        }
+    }
+    units = std::move(sorted_units);
+    occurrences = std::move(sorted_occurrences);
+    return sorted_cost;
+}
+
+std::vector<double> queens::sort_by_cost(std::vector<mini_board> &units, std::vector<uint32_t> &occurrences, uint8_t n,
+                                         uint8_t ring_width) {
+    return sort_units(units, occurrences, n, ring_width);
+}
+
+std::vector<double> queens::sort_by_cost(std::vector<packed_unit> &units, std::vector<uint32_t> &occurrences,
+                                         uint8_t n, uint8_t ring_width) {
+    return sort_units(units, occurrences, n, ring_width);
+}
+
+std::vector<chunk_ref> queens::list_chunks(std::array<size_t, ALL_SYMMETRIES.size()> const &units,
+                                           std::array<std::vector<double>, ALL_SYMMETRIES.size()> const &costs) {
+    std::vector<chunk_ref> chunks;
+    for (uint32_t sym = 0; sym < units.size(); sym++) {
+        for (size_t first = 0; first < units[sym]; first += SOLVE_CHUNK) {
+            double predicted = 0;
+            if (!costs[sym].empty()) {
+                size_t const last = std::min(first + SOLVE_CHUNK, units[sym]);
+                predicted = std::accumulate(costs[sym].begin() + first, costs[sym].begin() + last, 0.0);
+            }
+            chunks.push_back({sym, static_cast<uint32_t>(first / SOLVE_CHUNK), predicted});
+        }
+    }
+    std::stable_sort(chunks.begin(), chunks.end(),
+                     [](chunk_ref const &a, chunk_ref const &b) { return a.predicted > b.predicted; });
+    return chunks;
+}
+
+static double correlation(std::vector<double> const &a, std::vector<double> const &b) {
+    double const mean_a = std::accumulate(a.begin(), a.end(), 0.0) / a.size();
+    double const mean_b = std::accumulate(b.begin(), b.end(), 0.0) / b.size();
+    double cov = 0;
+    double var_a = 0;
+    double var_b = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        cov += (a[i] - mean_a) * (b[i] - mean_b);
+        var_a += (a[i] - mean_a) * (a[i] - mean_a);
+        var_b += (b[i] - mean_b) * (b[i] - mean_b);
+    }
+    return var_a > 0 && var_b > 0 ? cov / std::sqrt(var_a * var_b) : 0;
+}
+
+void queens::report_cost_model(std::ostream &out, std::vector<chunk_ref> const &chunks,
+                               std::vector<double> const &measured) {
+    std::vector<double> predicted;
+    std::vector<double> seconds;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (measured[i] >= 0) {
+            predicted.push_back(chunks[i].predicted);
+            seconds.push_back(measured[i]);
+        }
+    }
+    if (predicted.size() < 2) {
+        return;
+    }
+
+    double const total_predicted = std::accumulate(predicted.begin(), predicted.end(), 0.0);
+    double const total_seconds = std::accumulate(seconds.begin(), seconds.end(), 0.0);
+    out << "Cost model, " << predicted.size() << " chunks:" << std::endl;
+    out << "Correlation predicted / measured: " << correlation(predicted, seconds) << std::endl;
+    out << "Seconds per predicted cost: " << (total_predicted > 0 ? total_seconds / total_predicted : 0.0) << std::endl;
+
+    // The chunks are sorted by predicted cost, so each tenth of them is one decile of the prediction
+    out << "Decile   predicted   measured [s]   share of time" << std::endl;
+    for (unsigned d = 0; d < 10; d++) {
+        size_t const first = predicted.size() * d / 10;
+        size_t const last = predicted.size() * (d + 1) / 10;
+        if (first == last) {
+            continue;
+        }
+        double const p = std::accumulate(predicted.begin() + first, predicted.begin() + last, 0.0) / (last - first);
+        double const m = std::accumulate(seconds.begin() + first, seconds.begin() + last, 0.0);
+        out << std::setw(6) << d + 1 << std::setw(12) << p << std::setw(15) << m / (last - first) << std::setw(16)
+            << (total_seconds > 0 ? m / total_seconds : 0.0) << std::endl;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "mini_board.hpp"
+#include "packed_unit.hpp"
+#include "symmetry.hpp"
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief One chunk of SOLVE_CHUNK work units of a symmetry class.
+ */
+struct chunk_ref {
+        uint32_t sym; // Index of the symmetry class, see Symmetry::Direction
+        uint32_t chunk;
+        double predicted; // Predicted cost, 0 if the units are not ordered by cost
+};
+
+/**
+ * @brief Sort work units by their predicted cost, heaviest first, and keep their occurrences in the same order.
+ * @param units Work units of one symmetry class
+ * @param occurrences Occurrences of the units after dedup, or empty
+ * @return Predicted cost of each unit, in the new order
+ */
+std::vector<double> sort_by_cost(std::vector<mini_board> &units, std::vector<uint32_t> &occurrences, uint8_t n,
+                                 uint8_t ring_width);
+std::vector<double> sort_by_cost(std::vector<packed_unit> &units, std::vector<uint32_t> &occurrences, uint8_t n,
+                                 uint8_t ring_width);
+
+/**
+ * @brief List the chunks of all symmetry classes.
+ * @param units Number of work units per symmetry class
+ * @param costs Predicted cost of every unit per symmetry class, or empty to keep the chunks in generation order.
+ * Otherwise the chunks are sorted by their summed cost, heaviest first.
+ */
+std::vector<chunk_ref> list_chunks(std::array<size_t, ALL_SYMMETRIES.size()> const &units,
+                                   std::array<std::vector<double>, ALL_SYMMETRIES.size()> const &costs);
+
+/**
+ * @brief Compare the predicted with the measured cost of the solved chunks, to tune the cost model.
+ * @param chunks Chunks as returned by list_chunks()
+ * @param measured Seconds it took to solve each chunk, negative for chunks which were not solved
+ */
+void report_cost_model(std::ostream &out, std::vector<chunk_ref> const &chunks, std::vector<double> const &measured);
+
+} // namespace queens
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "numa.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace queens {
+
+/**
+ * @brief Work stealing scheduler over a fixed set of tasks.
+ *
+ * The tasks [0, count) are split into one contiguous range per worker. Each worker takes tasks from the front of its
+ * own range. When it runs empty it steals the back half of the range of another worker, so workers only go idle
+ * once no range has tasks left. There are no barriers between tasks, the caller only waits for the very last one.
+ *
+ * With a placement, each worker thread is pinned to its CPU and steals from the workers of its own NUMA node first,
+ * so tasks only move across nodes once a whole node runs dry.
+ */
+class work_pool {
+        // Remaining range of one worker, begin in the low and end in the high 32 bits, so owner and thieves can
+        // update it with a single compare and swap
+        struct alignas(64) range {
+                std::atomic<uint64_t> bounds;
+        };
+
+        static uint64_t pack(uint64_t begin, uint64_t end) { return begin | end << 32; }
+        static uint32_t begin(uint64_t bounds) { return static_cast<uint32_t>(bounds); }
+        static uint32_t end(uint64_t bounds) { return static_cast<uint32_t>(bounds >> 32); }
+
+        size_t const m_count;
+        std::vector<range> m_ranges;
+        std::vector<worker_placement> const m_placement;
+        std::vector<std::vector<unsigned>> m_victims; // Workers to steal from, in the order they are tried
+
+    public:
+        /**
+         * @param count Number of tasks, less than 2^32
+         * @param workers Number of workers
+         * @param placement Node and CPU of each worker, see place_workers(), or empty to leave the threads unpinned
+         */
+        work_pool(size_t count, unsigned workers, std::vector<worker_placement> placement = {})
+            : m_count(count), m_ranges(workers), m_placement(std::move(placement)), m_victims(workers) {
+            assert(workers > 0 && count < std::numeric_limits<uint32_t>::max());
+            assert(m_placement.empty() || m_placement.size() == workers);
+            for (unsigned w = 0; w < workers; w++) {
+                m_ranges[w].bounds.store(pack(first_task(w), first_task(w + 1)), std::memory_order_relaxed);
+                for (unsigned i = 1; i < workers; i++) {
+                    m_victims[w].push_back((w + i) % workers);
+                }
+                if (!m_placement.empty()) {
+                    std::stable_partition(m_victims[w].begin(), m_victims[w].end(), [&](unsigned v) {
+                        return m_placement[v].node == m_placement[w].node;
+                    });
+                }
+            }
+        }
+
+        unsigned workers() const { return m_ranges.size(); }
+
+        /**
+         * @brief First task of the range worker w starts with, first_task(workers()) is the number of tasks.
+         */
+        size_t first_task(unsigned w) const { return m_count * w / workers(); }
+
+        /**
+         * @brief Map the tasks to ranks, so the workers start with the tasks of the lowest ranks.
+         *
+         * Ranks are dealt round robin to the ranges of the workers, so each worker starts with one of the first ranks
+         * and stolen back halves hold the highest ranks of a range.
+         * @return rank[task] for the tasks of a pool of count tasks and workers workers
+         */
+        static std::vector<uint32_t> ranks(size_t count, unsigned workers) {
+            std::vector<size_t> next(workers);
+            std::vector<size_t> last(workers);
+            for (unsigned w = 0; w < workers; w++) {
+                next[w] = count * w / workers;
+                last[w] = count * (w + 1) / workers;
+            }
+            std::vector<uint32_t> rank(count);
+            unsigned w = 0;
+            for (size_t r = 0; r < count; r++, w = (w + 1) % workers) {
+                while (next[w] == last[w]) {
+                    w = (w + 1) % workers;
+                }
+                rank[next[w]++] = r;
+            }
+            return rank;
+        }
+
+        /**
+         * @brief Run fn(worker, task) for every task, the calling thread is worker 0 and the others get a thread each.
+         *
+         * The first exception thrown by fn is rethrown after all workers stopped, the remaining tasks are dropped.
+         */
+        template <typename Fn> void run(Fn &&fn) {
+            run(fn, [](unsigned) {});
+        }
+
+        /**
+         * @brief Same as run(fn), but each worker calls idle(worker) once no task is left, before it stops.
+         *
+         * The calling thread gets its CPUs back once the run is over.
+         */
+        template <typename Fn, typename Idle> void run(Fn &&fn, Idle &&idle) {
+            std::exception_ptr error;
+            std::mutex error_lock;
+            std::atomic<bool> failed{false};
+            std::vector<unsigned> const caller_cpus{m_placement.empty() ? std::vector<unsigned>{} : thread_cpus()};
+            auto worker = [&](unsigned w) {
+                try {
+                    if (!m_placement.empty()) {
+                        pin_thread({m_placement[w].cpu});
+                    }
+                    for (size_t task; !failed.load(std::memory_order_relaxed) && next(w, task);) {
+                        fn(w, task);
+                    }
+                    if (!failed.load(std::memory_order_relaxed)) {
+                        idle(w);
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard{error_lock};
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (unsigned w = 1; w < workers(); w++) {
+                threads.emplace_back(worker, w);
+            }
+            worker(0);
+            for (std::thread &t : threads) {
+                t.join();
+            }
+            if (!caller_cpus.empty()) {
+                pin_thread(caller_cpus);
+            }
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        /**
+         * @brief Take the next task of worker w, stealing from the others if its own range is empty.
+         * @return false if no worker has tasks left
+         */
+        bool next(unsigned w, size_t &task) {
+            std::atomic<uint64_t> &own = m_ranges[w].bounds;
+            uint64_t bounds = own.load(std::memory_order_relaxed);
+            while (begin(bounds) < end(bounds)) {
+                if (own.compare_exchange_weak(bounds, pack(begin(bounds) + 1, end(bounds)),
+                                              std::memory_order_relaxed)) {
+                    task = begin(bounds);
+                    return true;
+                }
+            }
+
+            // Own range is empty, so thieves leave it alone until the stolen half is stored
+            for (unsigned i : m_victims[w]) {
+                std::atomic<uint64_t> &victim = m_ranges[i].bounds;
+                uint64_t v = victim.load(std::memory_order_relaxed);
+                while (begin(v) < end(v)) {
+                    uint32_t const take = (end(v) - begin(v) + 1) / 2;
+                    uint32_t const split = end(v) - take;
+                    if (victim.compare_exchange_weak(v, pack(begin(v), split), std::memory_order_relaxed)) {
+                        own.store(pack(split + 1, end(v)), std::memory_order_relaxed);
+                        task = split;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+};
+
+} // namespace queens
@@ -0,0 +1,171 @@
+#include "workunit_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace queens;
+
+static uint64_t align_section(uint64_t offset) {
+    return (offset + workunit_file_header::SECTION_ALIGN - 1) / workunit_file_header::SECTION_ALIGN *
+           workunit_file_header::SECTION_ALIGN;
+}
+
+// The class which is streamed to the file while the others are buffered
+static const unsigned STREAMED{Symmetry{Symmetry::Direction::NONE}};
+
+workunit_file_writer::workunit_file_writer(std::string const &path, uint8_t boardsize, uint8_t ring_width)
+    : m_file{std::fopen(path.c_str(), "wb")}, m_path{path}, m_boardsize{boardsize}, m_ring_width{ring_width},
+      m_packed{packed_unit::fits(boardsize, ring_width)} {
+    if (m_file == nullptr) {
+        throw std::runtime_error("Can't create work unit file " + path + ": " + std::strerror(errno));
+    }
+
+    // Reserve space for the header, it is written by close() once all counts are known. Until then the file has no
+    // valid magic, so an aborted run is never mistaken for a complete one.
+    if (std::fseek(m_file, align_section(sizeof(workunit_file_header)), SEEK_SET) != 0) {
+        throw std::runtime_error("Can't write work unit file " + path + ": " + std::strerror(errno));
+    }
+}
+
+workunit_file_writer::~workunit_file_writer() {
+    if (m_file != nullptr) {
+        std::fclose(m_file);
+    }
+}
+
+void workunit_file_writer::add(Board const &brd, Symmetry sym) {
+    mini_board unit{};
+    packed_unit packed{};
+    void const *data = &unit;
+    size_t size = sizeof(unit);
+    if (m_packed) {
+        packed = packed_unit::pack(brd, m_ring_width);
+        data = &packed;
+        size = sizeof(packed);
+    } else {
+        unit = mini_board{brd, m_ring_width};
+    }
+
+    m_counts[sym]++;
+    if (static_cast<unsigned>(sym) == STREAMED) {
+        if (std::fwrite(data, size, 1, m_file) != 1) {
+            throw std::runtime_error("Can't write work unit file " + m_path + ": " + std::strerror(errno));
+        }
+    } else {
+        char const *bytes = static_cast<char const *>(data);
+        m_pending[sym].insert(m_pending[sym].end(), bytes, bytes + size);
+    }
+}
+
+void workunit_file_writer::close() {
+    workunit_file_header header{};
+    header.magic = workunit_file_header::MAGIC;
+    header.version = workunit_file_header::VERSION;
+    header.boardsize = m_boardsize;
+    header.ring_width = m_ring_width;
+    header.unit_size = m_packed ? sizeof(packed_unit) : sizeof(mini_board);
+
+    uint64_t offset = align_section(sizeof(workunit_file_header));
+    header.sections[STREAMED] = {offset, m_counts[STREAMED]};
+    offset += m_counts[STREAMED] * header.unit_size;
+
+    auto fail = [&]() {
+        throw std::runtime_error("Can't write work unit file " + m_path + ": " + std::strerror(errno));
+    };
+
+    for (Symmetry const &sym : ALL_SYMMETRIES) {
+        if (static_cast<unsigned>(sym) == STREAMED) {
+            continue;
+        }
+        offset = align_section(offset);
+        header.sections[sym] = {offset, m_counts[sym]};
+        if (std::fseek(m_file, offset, SEEK_SET) != 0) {
+            fail();
+        }
+        std::vector<char> const &units = m_pending[sym];
+        if (std::fwrite(units.data(), 1, units.size(), m_file) != units.size()) {
+            fail();
+        }
+        offset += units.size();
+    }
+
+    if (std::fseek(m_file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, m_file) != 1) {
+        fail();
+    }
+    std::FILE *file = m_file;
+    m_file = nullptr;
+    if (std::fclose(file) != 0) {
+        fail();
+    }
+}
+
+workunit_file_reader::workunit_file_reader(std::string const &path) : m_map{MAP_FAILED}, m_size{0}, m_header{} {
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Can't open work unit file " + path + ": " + std::strerror(errno));
+    }
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Can't stat work unit file " + path + ": " + std::strerror(errno));
+    }
+    m_size = st.st_size;
+    if (m_size < sizeof(workunit_file_header)) {
+        ::close(fd);
+        throw std::runtime_error("Work unit file " + path + " is truncated");
+    }
+
+    m_map = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after closing the descriptor
+    ::close(fd);
+    if (m_map == MAP_FAILED) {
+        throw std::runtime_error("Can't map work unit file " + path + ": " + std::strerror(errno));
+    }
+    // Workers walk the sections front to back
+    ::madvise(m_map, m_size, MADV_SEQUENTIAL);
+
+    std::memcpy(&m_header, m_map, sizeof(m_header));
+    std::string error;
+    if (m_header.magic != workunit_file_header::MAGIC) {
+        error = "is not a work unit file or incomplete";
+    } else if (m_header.version != workunit_file_header::VERSION) {
+        error = "has unsupported version " + std::to_string(m_header.version);
+    } else if (m_header.unit_size != sizeof(mini_board) &&
+               (m_header.unit_size != sizeof(packed_unit) ||
+                !packed_unit::fits(m_header.boardsize, m_header.ring_width))) {
+        error = "has unsupported unit size " + std::to_string(m_header.unit_size);
+    } else {
+        for (auto const &section : m_header.sections) {
+            if (section.offset % workunit_file_header::SECTION_ALIGN != 0 || section.offset > m_size ||
+                section.count > (m_size - section.offset) / m_header.unit_size) {
+                error = "has a section outside of the file";
+            }
+        }
+    }
+    if (!error.empty()) {
+        ::munmap(m_map, m_size);
+        throw std::runtime_error("Work unit file " + path + " " + error);
+    }
+}
+
+workunit_file_reader::~workunit_file_reader() {
+    if (m_map != MAP_FAILED) {
+        ::munmap(m_map, m_size);
+    }
+}
+
+unit_span workunit_file_reader::units(Symmetry sym) const {
+    auto const &section = m_header.sections[sym];
+    char const *const data = static_cast<char const *>(m_map) + section.offset;
+    if (packed()) {
+        return {{reinterpret_cast<packed_unit const *>(data), section.count}, m_header.boardsize, m_header.ring_width};
+    }
+    return std::span<mini_board const>{reinterpret_cast<mini_board const *>(data), section.count};
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "board.hpp"
+#include "mini_board.hpp"
+#include "packed_unit.hpp"
+#include "symmetry.hpp"
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace queens {
+
+/**
+ * On-disk layout of a work unit file. All fields are stored in host byte order.
+ *
+ * The header is followed by one section per symmetry class, each is a plain array of units. Units are packed_unit
+ * whenever packed_unit::fits() the board size and ring width, else mini_board, unit_size tells which. Sections are
+ * aligned to SECTION_ALIGN, so sections of either can be used in place after mapping the file.
+ */
+struct workunit_file_header {
+        static constexpr std::array<char, 8> MAGIC{'M', 'Q', '3', 'W', 'O', 'R', 'K', '\0'};
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint64_t SECTION_ALIGN = 64;
+
+        struct section {
+                uint64_t offset; // Byte offset of the section from the start of the file
+                uint64_t count;  // Number of work units in the section
+        };
+
+        std::array<char, 8> magic;
+        uint32_t version;
+        uint8_t boardsize;
+        uint8_t ring_width;
+        uint16_t unit_size; // sizeof(packed_unit) or sizeof(mini_board) of the writer
+        std::array<section, ALL_SYMMETRIES.size()> sections; // Indexed by Symmetry
+};
+
+/**
+ * @brief Write preplacements to a work unit file while they are generated.
+ *
+ * The NONE class holds almost all units, it is streamed to the file directly. POINT and ROTATE units are rare and
+ * kept in memory until close() appends them and writes the final header.
+ */
+class workunit_file_writer {
+        std::FILE *m_file;
+        std::string m_path;
+        uint8_t m_boardsize;
+        uint8_t m_ring_width;
+        bool m_packed;
+        std::array<uint64_t, ALL_SYMMETRIES.size()> m_counts{};
+        std::array<std::vector<char>, ALL_SYMMETRIES.size()> m_pending; // Units as they are written to the file
+
+    public:
+        /**
+         * @brief Create the file, throws std::runtime_error on failure.
+         * @param path Path of the file
+         * @param boardsize Size of the board the units are for
+         * @param ring_width Width of the coronal ring of the units
+         */
+        workunit_file_writer(std::string const &path, uint8_t boardsize, uint8_t ring_width);
+        ~workunit_file_writer();
+        workunit_file_writer(workunit_file_writer const &) = delete;
+        workunit_file_writer &operator=(workunit_file_writer const &) = delete;
+
+        /**
+         * @brief Add the preplacement of a board, throws std::runtime_error on failure.
+         */
+        void add(Board const &brd, Symmetry sym);
+
+        /**
+         * @brief Check if the units are written as packed_unit.
+         */
+        bool packed() const { return m_packed; }
+
+        /**
+         * @brief Write the remaining sections and the header, throws std::runtime_error on failure.
+         */
+        void close();
+};
+
+/**
+ * @brief Map a work unit file into memory and give out its sections.
+ *
+ * Sections are given out without copying, packed ones stay packed until the solver decodes them chunk by chunk.
+ */
+class workunit_file_reader {
+        void *m_map;
+        size_t m_size;
+        workunit_file_header m_header;
+
+    public:
+        /**
+         * @brief Open and validate the file, throws std::runtime_error on failure.
+         * @param path Path of the file
+         */
+        explicit workunit_file_reader(std::string const &path);
+        ~workunit_file_reader();
+        workunit_file_reader(workunit_file_reader const &) = delete;
+        workunit_file_reader &operator=(workunit_file_reader const &) = delete;
+
+        uint8_t boardsize() const { return m_header.boardsize; }
+        uint8_t ring_width() const { return m_header.ring_width; }
+        bool packed() const { return m_header.unit_size == sizeof(packed_unit); }
+
+        /**
+         * @brief Work units of one symmetry class, valid as long as the reader lives.
+         */
+        unit_span units(Symmetry sym) const;
+};
+
+} // namespace queens